@@ -30,6 +30,15 @@ namespace astrophototoolbox {
 
         void interpolate(DoubleGrayBitmap* bitmap) const;
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Interpolate 'count' values in place, separated by 'offset' elements
+        ///
+        /// The results are the same than the ones of 'interpolate(double)' converted to
+        /// 'T', but the loop can be vectorized by the compiler.
+        //--------------------------------------------------------------------------------
+        template<typename T>
+        void interpolate(T* values, size_t count, size_t offset = 1) const;
+
 
         //_____ Attributes __________
     private:
@@ -37,4 +46,37 @@ namespace astrophototoolbox {
         double min, max;
     };
 
+
+    template<typename T>
+    inline void Interpolation::interpolate(T* values, size_t count, size_t offset) const
+    {
+        // Local copies, since the values might alias the attributes. The clamping is
+        // written like 'std::min()' and 'std::max()' do it, to get the same results
+        const double a = this->a;
+        const double b = this->b;
+        const double c = this->c;
+        const double min = this->min;
+        const double max = this->max;
+
+        if (b || c)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const double x = values[i * offset];
+                const double y = (x + a) / (b * x + c);
+                const double clamped = (max < y ? max : y);
+                values[i * offset] = T(clamped < min ? min : clamped);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const double y = values[i * offset] + a;
+                const double clamped = (max < y ? max : y);
+                values[i * offset] = T(clamped < min ? min : clamped);
+            }
+        }
+    }
+
 }
@@ -10,6 +10,9 @@
 
 #include <astrophoto-toolbox/algorithms/histogram.h>
 #include <numeric>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 
 namespace astrophototoolbox {
@@ -74,6 +77,180 @@ namespace astrophototoolbox {
         return computeStandardDeviation(values.data(), values.size(), average);
     }
 
+    //------------------------------------------------------------------------------------
+    /// @brief  Select the median of an array of values (in-place)
+    ///
+    /// Contrary to the histogram-based methods, the result is exact for every type of
+    /// values. When the number of values is even, the lower of the two middle values is
+    /// returned. The order of the values in the array is modified.
+    ///
+    /// Small arrays (the usual case when stacking a few frames) are handled with a
+    /// sorting network or an insertion sort, bigger ones with a selection algorithm.
+    //------------------------------------------------------------------------------------
+    template<typename T>
+    inline T selectMedian(T* values, size_t count)
+    {
+        if (count == 0)
+            return T(0);
+
+        const size_t k = (count - 1) / 2;
+
+        if (count <= 2)
+            return std::min(values[0], values[count - 1]);
+
+        if (count == 3)
+        {
+            const T a = std::min(values[0], values[1]);
+            const T b = std::max(values[0], values[1]);
+            return std::max(a, std::min(b, values[2]));
+        }
+
+        if (count <= 16)
+        {
+            for (size_t i = 1; i < count; ++i)
+            {
+                const T v = values[i];
+                size_t j = i;
+                while ((j > 0) && (v < values[j - 1]))
+                {
+                    values[j] = values[j - 1];
+                    --j;
+                }
+                values[j] = v;
+            }
+
+            return values[k];
+        }
+
+        std::nth_element(values, values + k, values + count);
+        return values[k];
+    }
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Select the median of a vector of values (in-place)
+    ///
+    /// See the array version for details.
+    //------------------------------------------------------------------------------------
+    template<typename T>
+    inline T selectMedian(std::vector<T>& values)
+    {
+        return selectMedian(values.data(), values.size());
+    }
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Compute the average of an array of values, after iteratively rejecting
+    ///         the ones located further than 'kappa' standard deviations from it
+    ///
+    /// The iterations stop as soon as no more value is rejected.
+    //------------------------------------------------------------------------------------
+    template<typename T>
+    inline double computeKappaSigmaClippedAverage(
+        const T* values, size_t count, double kappa, unsigned int nbIterations
+    )
+    {
+        double low = -std::numeric_limits<double>::infinity();
+        double high = std::numeric_limits<double>::infinity();
+        double average = 0.0;
+        size_t previousCount = 0;
+
+        for (unsigned int iteration = 0; iteration < nbIterations; ++iteration)
+        {
+            double sum = 0.0;
+            double squareSum = 0.0;
+            size_t n = 0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const double v = values[i];
+                if ((v >= low) && (v <= high))
+                {
+                    sum += v;
+                    squareSum += v * v;
+                    ++n;
+                }
+            }
+
+            if ((n == 0) || (n == previousCount))
+                break;
+
+            average = sum / n;
+            const double sigma = sqrt(std::max(squareSum / n - average * average, 0.0));
+
+            low = average - kappa * sigma;
+            high = average + kappa * sigma;
+            previousCount = n;
+        }
+
+        return average;
+    }
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Compute the average of an array of values, after rejecting the ones
+    ///         located further than 'kappa' standard deviations from the median
+    ///
+    /// The standard deviation is estimated robustly, by iteratively winsorizing the
+    /// values (clamping them at 1.5 sigma from the median) until it converges. The order
+    /// of the values in the array is modified.
+    //------------------------------------------------------------------------------------
+    template<typename T>
+    inline double computeWinsorizedSigmaClippedAverage(
+        T* values, size_t count, double kappa, unsigned int nbIterations
+    )
+    {
+        if (count == 0)
+            return 0.0;
+
+        const double median = selectMedian(values, count);
+
+        double average = 0.0;
+        double sigma = computeStandardDeviation(values, count, average);
+
+        for (unsigned int iteration = 0; (iteration < nbIterations) && (sigma > 0.0); ++iteration)
+        {
+            const double low = median - 1.5 * sigma;
+            const double high = median + 1.5 * sigma;
+
+            double sum = 0.0;
+            double squareSum = 0.0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const double v = std::clamp(double(values[i]), low, high);
+                sum += v;
+                squareSum += v * v;
+            }
+
+            average = sum / count;
+
+            // 1.134: correction factor for the variance reduction due to winsorization
+            const double newSigma = 1.134 * sqrt(std::max(squareSum / count - average * average, 0.0));
+
+            const bool converged = (fabs(newSigma - sigma) <= sigma * 0.0005);
+            sigma = newSigma;
+
+            if (converged)
+                break;
+        }
+
+        const double low = median - kappa * sigma;
+        const double high = median + kappa * sigma;
+
+        double sum = 0.0;
+        size_t n = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double v = values[i];
+            if ((v >= low) && (v <= high))
+            {
+                sum += v;
+                ++n;
+            }
+        }
+
+        return (n > 0 ? sum / n : median);
+    }
+
     //------------------------------------------------------------------------------------
     /// @brief  Compute the median of an array of values, using an existing histogram to
     ///         cache values
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace astrophototoolbox {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  A set of worker threads, kept alive from one task to the next
+    ///
+    /// Useful when a lot of small tasks must be run in parallel (like the bands of a
+    /// bitmap), to avoid creating new threads for each of them. The threads are only
+    /// created when needed by the first task.
+    //------------------------------------------------------------------------------------
+    class WorkerPool
+    {
+        //_____ Construction / Destruction __________
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Constructor
+        ///
+        /// 'nbThreads' is the number of threads running a task, including the calling
+        /// one (0 means one thread per core).
+        //--------------------------------------------------------------------------------
+        WorkerPool(unsigned int nbThreads = 0);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+
+        //_____ Methods __________
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Run 'task' on at most 'nbThreads' threads at the same time (including
+        ///         the calling one), and wait until all of them are done
+        ///
+        /// 0 means all the threads of the pool. Only one task can be run at a time.
+        //--------------------------------------------------------------------------------
+        void run(const std::function<void()>& task, unsigned int nbThreads = 0);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of threads running a task, including the calling
+        ///         one
+        //--------------------------------------------------------------------------------
+        inline unsigned int nbThreads() const
+        {
+            return size;
+        }
+
+
+    private:
+        void loop(unsigned int index, uint64_t lastTask);
+
+
+        //_____ Attributes __________
+    private:
+        unsigned int size;
+        std::vector<std::thread> threads;
+
+        std::mutex mutex;
+        std::condition_variable taskCondition;
+        std::condition_variable doneCondition;
+
+        const std::function<void()>* task = nullptr;
+        uint64_t taskIndex = 0;
+        unsigned int nbParticipants = 0;    // Number of threads of the pool used by the task
+        unsigned int nbRunning = 0;
+        bool stopping = false;
+    };
+
+}
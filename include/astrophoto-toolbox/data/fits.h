@@ -200,6 +200,12 @@ namespace astrophototoolbox {
         bool gotoHDU(const std::string& name, int type);
         bool gotoHDU(int index, int type, const std::string& datatype = "");
 
+        template<typename T, typename S>
+        void writePixels(const Bitmap* bitmap, int datatype, T offset, int& status);
+
+        template<typename T>
+        void readPixels(Bitmap* bitmap, int datatype, int& status);
+
 
         //_____ Attributes __________
     private:
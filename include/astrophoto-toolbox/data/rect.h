@@ -44,7 +44,7 @@ namespace astrophototoolbox {
             return bottom - top;
         }
 
-        inline rect_t intersection(const rect_t& other)
+        inline rect_t intersection(const rect_t& other) const
         {
             return rect_t(
                 std::max(left, other.left),
@@ -10,11 +10,38 @@
 
 #include <astrophoto-toolbox/data/point.h>
 #include <astrophoto-toolbox/data/rect.h>
+#include <astrophoto-toolbox/data/size.h>
+#include <astrophoto-toolbox/algorithms/workerpool.h>
 
 
 namespace astrophototoolbox
 {
 
+    //------------------------------------------------------------------------------------
+    /// @brief  The interpolation kernels usable to transform a bitmap
+    //------------------------------------------------------------------------------------
+    enum interpolation_t
+    {
+        INTERPOLATION_BILINEAR,
+        INTERPOLATION_BICUBIC,
+        INTERPOLATION_LANCZOS3,
+    };
+
+
+    //------------------------------------------------------------------------------------
+    /// @brief  The kinds of transformations, from the cheapest to the most expensive to
+    ///         apply to a bitmap
+    //------------------------------------------------------------------------------------
+    enum transformation_class_t
+    {
+        TRANSFORMATION_IDENTITY,
+        TRANSFORMATION_INTEGER_SHIFT,
+        TRANSFORMATION_SUBPIXEL_SHIFT,
+        TRANSFORMATION_RIGID,               ///< Rotation + shift
+        TRANSFORMATION_GENERIC,
+    };
+
+
     class Transformation
     {
     public:
@@ -37,36 +64,157 @@ namespace astrophototoolbox
 
         rect_t transform(const rect_t& rect) const noexcept;
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Determine the kind of the transformation, for a bitmap of the given
+        ///         size
+        ///
+        /// The transformation is considered to be of one kind if no pixel of the bitmap
+        /// would be moved by more than 'tolerance' pixels compared to the exact
+        /// transformation of this kind.
+        //--------------------------------------------------------------------------------
+        transformation_class_t classify(
+            const size2d_t& size, double tolerance = 0.01
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns a new bitmap containing the transformed version of the given
+        ///         one
+        ///
+        /// Each pixel of the new bitmap is computed by applying the inverse transformation
+        /// to its coordinates, and by interpolating the source bitmap at the resulting
+        /// location. The pixels falling outside of the source bitmap are set to 0.
+        ///
+        /// Faster code paths are used for shifts (integer or not) and rigid
+        /// transformations, based on the classification of the transformation (see
+        /// 'classify()').
+        ///
+        /// The rows are processed in parallel by 'nbThreads' threads (0 means one thread
+        /// per core).
+        //--------------------------------------------------------------------------------
+        template<class BITMAP>
+        BITMAP* transform(
+            BITMAP* bitmap, interpolation_t interpolation = INTERPOLATION_BILINEAR,
+            unsigned int nbThreads = 0
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the pixels of an area of the transformed version of the given
+        ///         bitmap
+        ///
+        /// The rows of the area are written in 'rows', without padding between them. All
+        /// the pixels of the area are written (the ones falling outside of the source
+        /// bitmap are set to 0). The area must be inside the bitmap.
+        ///
+        /// This allows to process a bitmap band by band, without allocating a complete
+        /// transformed bitmap. See the other overload for details.
+        //--------------------------------------------------------------------------------
+        template<class BITMAP>
+        void transform(
+            const BITMAP* bitmap, typename BITMAP::type_t* rows, const rect_t& area,
+            interpolation_t interpolation = INTERPOLATION_BILINEAR,
+            unsigned int nbThreads = 0
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the pixels of an area of the transformed version of the given
+        ///         bitmap, using an already known kind of transformation and the threads
+        ///         of a pool
+        ///
+        /// 'kind' must have been returned by 'classify()' for the size of the bitmap.
+        /// When a bitmap is processed band by band, this avoids classifying the
+        /// transformation and creating new threads for each band.
+        //--------------------------------------------------------------------------------
         template<class BITMAP>
-            requires(BITMAP::Channels == 3)
-        BITMAP* transform(BITMAP* bitmap) const noexcept
-        {
-            double median = computeMedian(bitmap);
-
-            BITMAP* target = new BITMAP(bitmap->width(), bitmap->height());
-
-            for (unsigned int y = 0; y < bitmap->height(); ++y)
-            {
-                for (unsigned int x = 0; x < bitmap->width(); ++x)
-                {
-                    point_t p = transform(point_t(x, y));
-
-                    int xx = int(p.x);
-                    int yy = int(p.y);
-
-                    if ((xx >= 0) && (xx < target->width()) && (yy >= 0) && (yy < target->height()))
-                    {
-                        typename BITMAP::type_t* src = (typename BITMAP::type_t*) bitmap->ptr(x, y);
-                        typename BITMAP::type_t* dest = target->data(xx, yy);
-                        dest[0] = src[0];
-                        dest[1] = src[1];
-                        dest[2] = src[2];
-                    }
-                }
-            }
-
-            return target;
-        }
+        void transform(
+            const BITMAP* bitmap, typename BITMAP::type_t* rows, const rect_t& area,
+            transformation_class_t kind, interpolation_t interpolation,
+            WorkerPool& workers
+        ) const noexcept;
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the coordinates in the source bitmap of 'count' pixels of a
+        ///         row of the transformed bitmap, starting at column 'x'
+        ///
+        /// If 'bilinear' is false, the 'X * Y' terms of the transformation are ignored.
+        ///
+        /// Returns false if the transformation can't be inverted.
+        //--------------------------------------------------------------------------------
+        bool computeSourceCoordinates(
+            unsigned int x, unsigned int y, unsigned int count, double* xs, double* ys,
+            bool bilinear = true
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the pixels of an area of the transformed bitmap
+        ///
+        /// 'output(y)' must return a pointer to the first pixel of the area in the row
+        /// 'y' of the destination.
+        //--------------------------------------------------------------------------------
+        template<class BITMAP, typename OUTPUT>
+        void transformArea(
+            const BITMAP* bitmap, OUTPUT output, const rect_t& area,
+            transformation_class_t kind, interpolation_t interpolation,
+            WorkerPool& workers
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the pixels of an area of the transformed bitmap, using the
+        ///         fastest code path for the kind of the transformation
+        //--------------------------------------------------------------------------------
+        template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+        void apply(
+            const BITMAP* source, OUTPUT output, const rect_t& area,
+            transformation_class_t kind, WorkerPool& workers, unsigned int nbThreads,
+            KERNEL kernel
+        ) const noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Copy the source bitmap into the destination, shifted by a number of
+        ///         pixels
+        //--------------------------------------------------------------------------------
+        template<class BITMAP, typename OUTPUT>
+        static void copyShifted(
+            const BITMAP* source, OUTPUT output, const rect_t& area, int dX, int dY
+        ) noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Shift the source bitmap into the destination by a non-integer amount,
+        ///         using a separable filter
+        //--------------------------------------------------------------------------------
+        template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+        static void shift(
+            const BITMAP* source, OUTPUT output, const rect_t& area, double dX, double dY,
+            WorkerPool& workers, unsigned int nbThreads, KERNEL kernel
+        ) noexcept;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Apply the transformation to any bitmap, by interpolating the source
+        ///         bitmap at the inverse-mapped coordinates of each pixel
+        ///
+        /// If 'bilinear' is false, the 'X * Y' terms of the transformation are ignored.
+        //--------------------------------------------------------------------------------
+        template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+        void warp(
+            const BITMAP* source, OUTPUT output, const rect_t& area, WorkerPool& workers,
+            unsigned int nbThreads, KERNEL kernel, bool bilinear = true
+        ) const noexcept;
+
+        template<int RADIUS, class BITMAP, typename KERNEL>
+        static void interpolateRow(
+            const BITMAP* source, typename BITMAP::type_t* dest, unsigned int count,
+            const double* xs, const double* ys, KERNEL kernel
+        ) noexcept;
+
+        template<typename T>
+        static inline T toValue(double value) noexcept;
+
+        static inline void bilinearWeights(double t, double* weights) noexcept;
+        static inline void bicubicWeights(double t, double* weights) noexcept;
+        static inline void lanczos3Weights(double t, double* weights) noexcept;
     };
 
 }
+
+
+#include <astrophoto-toolbox/data/transformation.hpp>
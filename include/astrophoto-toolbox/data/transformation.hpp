@@ -0,0 +1,468 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace astrophototoolbox {
+
+
+template<class BITMAP>
+BITMAP* Transformation::transform(
+    BITMAP* bitmap, interpolation_t interpolation, unsigned int nbThreads
+) const noexcept
+{
+    BITMAP* target = new BITMAP(
+        bitmap->width(), bitmap->height(), bitmap->range(), bitmap->space()
+    );
+
+    if ((bitmap->width() == 0) || (bitmap->height() == 0))
+        return target;
+
+    WorkerPool workers(nbThreads);
+
+    transformArea(
+        bitmap, [target](unsigned int y) { return target->data(y); },
+        rect_t(0, 0, bitmap->width(), bitmap->height()),
+        classify(size2d_t(bitmap->width(), bitmap->height())), interpolation, workers
+    );
+
+    return target;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void Transformation::transform(
+    const BITMAP* bitmap, typename BITMAP::type_t* rows, const rect_t& area,
+    interpolation_t interpolation, unsigned int nbThreads
+) const noexcept
+{
+    WorkerPool workers(nbThreads);
+
+    transform(
+        bitmap, rows, area, classify(size2d_t(bitmap->width(), bitmap->height())),
+        interpolation, workers
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void Transformation::transform(
+    const BITMAP* bitmap, typename BITMAP::type_t* rows, const rect_t& area,
+    transformation_class_t kind, interpolation_t interpolation, WorkerPool& workers
+) const noexcept
+{
+    const size_t nbRowElements = size_t(area.width()) * BITMAP::Channels;
+
+    transformArea(
+        bitmap,
+        [rows, &area, nbRowElements](unsigned int y)
+        {
+            return rows + (y - area.top) * nbRowElements;
+        },
+        area, kind, interpolation, workers
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP, typename OUTPUT>
+void Transformation::transformArea(
+    const BITMAP* bitmap, OUTPUT output, const rect_t& area,
+    transformation_class_t kind, interpolation_t interpolation, WorkerPool& workers
+) const noexcept
+{
+    if ((area.width() <= 0) || (area.height() <= 0))
+        return;
+
+    const unsigned int nbThreads = std::min(workers.nbThreads(), (unsigned int) area.height());
+
+    switch (interpolation)
+    {
+        case INTERPOLATION_BICUBIC:
+            apply<2>(
+                bitmap, output, area, kind, workers, nbThreads,
+                [](double t, double* weights) { bicubicWeights(t, weights); }
+            );
+            break;
+
+        case INTERPOLATION_LANCZOS3:
+            apply<3>(
+                bitmap, output, area, kind, workers, nbThreads,
+                [](double t, double* weights) { lanczos3Weights(t, weights); }
+            );
+            break;
+
+        default:
+            apply<1>(
+                bitmap, output, area, kind, workers, nbThreads,
+                [](double t, double* weights) { bilinearWeights(t, weights); }
+            );
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+void Transformation::apply(
+    const BITMAP* source, OUTPUT output, const rect_t& area,
+    transformation_class_t kind, WorkerPool& workers, unsigned int nbThreads,
+    KERNEL kernel
+) const noexcept
+{
+    double dX, dY;
+    offsets(dX, dY);
+
+    switch (kind)
+    {
+        case TRANSFORMATION_IDENTITY:
+            copyShifted(source, output, area, 0, 0);
+            break;
+
+        case TRANSFORMATION_INTEGER_SHIFT:
+            copyShifted(source, output, area, (int) std::round(dX), (int) std::round(dY));
+            break;
+
+        case TRANSFORMATION_SUBPIXEL_SHIFT:
+            shift<RADIUS>(source, output, area, dX, dY, workers, nbThreads, kernel);
+            break;
+
+        // The 'X * Y' terms of a transformation classified as rigid are small enough
+        // to be ignored (their effect is bounded by the tolerance of 'classify()'), so
+        // the source coordinates are computed incrementally, without any refinement
+        case TRANSFORMATION_RIGID:
+            warp<RADIUS>(source, output, area, workers, nbThreads, kernel, false);
+            break;
+
+        default:
+            warp<RADIUS>(source, output, area, workers, nbThreads, kernel);
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP, typename OUTPUT>
+void Transformation::copyShifted(
+    const BITMAP* source, OUTPUT output, const rect_t& area, int dX, int dY
+) noexcept
+{
+    const int width = (int) source->width();
+    const int height = (int) source->height();
+    const size_t pixelSize = BITMAP::Channels * BITMAP::ChannelSize;
+
+    // Columns of the area with a source pixel
+    const int startX = std::clamp(dX, area.left, area.right);
+    const int endX = std::clamp(width + dX, startX, area.right);
+
+    // No source pixel at all in the area (shifted by more than the size of the bitmap)
+    if (startX == endX)
+    {
+        for (int y = area.top; y < area.bottom; ++y)
+            memset(output(y), 0, area.width() * pixelSize);
+
+        return;
+    }
+
+    for (int y = area.top; y < area.bottom; ++y)
+    {
+        uint8_t* dest = (uint8_t*) output(y);
+        const int sy = y - dY;
+
+        if ((sy < 0) || (sy >= height))
+        {
+            memset(dest, 0, area.width() * pixelSize);
+            continue;
+        }
+
+        memset(dest, 0, (startX - area.left) * pixelSize);
+        memcpy(
+            dest + (startX - area.left) * pixelSize, source->data(startX - dX, sy),
+            (endX - startX) * pixelSize
+        );
+        memset(dest + (endX - area.left) * pixelSize, 0, (area.right - endX) * pixelSize);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+void Transformation::shift(
+    const BITMAP* source, OUTPUT output, const rect_t& area, double dX, double dY,
+    WorkerPool& workers, unsigned int nbThreads, KERNEL kernel
+) noexcept
+{
+    typedef typename BITMAP::type_t type_t;
+
+    constexpr int NbTaps = 2 * RADIUS;
+    constexpr int Channels = BITMAP::Channels;
+    constexpr double Epsilon = 1e-6;
+
+    const int width = (int) source->width();
+    const int height = (int) source->height();
+
+    // The source pixel of (x, y) is at (x + offsetX + fracX, y + offsetY + fracY), so
+    // the weights are the same for all the pixels
+    const int offsetX = (int) std::floor(-dX);
+    const int offsetY = (int) std::floor(-dY);
+
+    double wx[NbTaps];
+    double wy[NbTaps];
+    kernel(-dX - offsetX, wx);
+    kernel(-dY - offsetY, wy);
+
+    // Range of the pixels of the area with a source location inside the source bitmap
+    const int startX = std::clamp((int) std::ceil(dX - Epsilon), area.left, area.right);
+    const int endX = std::clamp((int) std::floor(width - 1 + dX + Epsilon) + 1, startX, area.right);
+    const int startY = std::max((int) std::ceil(dY - Epsilon), 0);
+    const int endY = std::min((int) std::floor(height - 1 + dY + Epsilon) + 1, height);
+
+    std::atomic<int> nextRow = area.top;
+
+    workers.run([&]()
+    {
+        // Vertically filtered source row, with RADIUS pixels of padding on each side
+        // (replicating the borders)
+        std::vector<double> buffer((width + 2 * RADIUS) * Channels);
+        double* filtered = buffer.data() + RADIUS * Channels;
+
+        for (int y = nextRow++; y < area.bottom; y = nextRow++)
+        {
+            type_t* dest = output(y);
+
+            if ((y < startY) || (y >= endY) || (startX == endX))
+            {
+                std::fill(dest, dest + area.width() * Channels, type_t(0));
+                continue;
+            }
+
+            // Vertical pass
+            std::fill(buffer.begin(), buffer.end(), 0.0);
+
+            for (int j = 0; j < NbTaps; ++j)
+            {
+                const int sy = std::clamp(y + offsetY - RADIUS + 1 + j, 0, height - 1);
+                const type_t* src = source->data(sy);
+                const double w = wy[j];
+
+                for (int i = 0; i < width * Channels; ++i)
+                    filtered[i] += w * double(src[i]);
+            }
+
+            for (int i = 0; i < RADIUS * Channels; ++i)
+            {
+                buffer[i] = filtered[i % Channels];
+                filtered[width * Channels + i] = filtered[(width - 1) * Channels + i % Channels];
+            }
+
+            // Horizontal pass
+            std::fill(dest, dest + (startX - area.left) * Channels, type_t(0));
+            std::fill(
+                dest + (endX - area.left) * Channels, dest + area.width() * Channels,
+                type_t(0)
+            );
+
+            dest += (startX - area.left) * Channels;
+            const double* row = filtered + (startX + offsetX - RADIUS + 1) * Channels;
+
+            for (int x = startX; x < endX; ++x, dest += Channels, row += Channels)
+            {
+                for (int c = 0; c < Channels; ++c)
+                {
+                    double sum = 0.0;
+
+                    for (int i = 0; i < NbTaps; ++i)
+                        sum += wx[i] * row[i * Channels + c];
+
+                    dest[c] = toValue<type_t>(sum);
+                }
+            }
+        }
+    }, nbThreads);
+}
+
+//-----------------------------------------------------------------------------
+
+template<int RADIUS, class BITMAP, typename OUTPUT, typename KERNEL>
+void Transformation::warp(
+    const BITMAP* source, OUTPUT output, const rect_t& area, WorkerPool& workers,
+    unsigned int nbThreads, KERNEL kernel, bool bilinear
+) const noexcept
+{
+    const unsigned int count = area.width();
+
+    // Each thread picks the next row to process until all of them are done
+    std::atomic<int> nextRow = area.top;
+
+    workers.run([&]()
+    {
+        std::vector<double> xs(count);
+        std::vector<double> ys(count);
+
+        for (int y = nextRow++; y < area.bottom; y = nextRow++)
+        {
+            typename BITMAP::type_t* dest = output(y);
+
+            if (computeSourceCoordinates(area.left, y, count, xs.data(), ys.data(), bilinear))
+                interpolateRow<RADIUS>(source, dest, count, xs.data(), ys.data(), kernel);
+            else
+                std::fill(dest, dest + count * BITMAP::Channels, typename BITMAP::type_t(0));
+        }
+    }, nbThreads);
+}
+
+//-----------------------------------------------------------------------------
+
+template<int RADIUS, class BITMAP, typename KERNEL>
+void Transformation::interpolateRow(
+    const BITMAP* source, typename BITMAP::type_t* dest, unsigned int count,
+    const double* xs, const double* ys, KERNEL kernel
+) noexcept
+{
+    typedef typename BITMAP::type_t type_t;
+
+    constexpr int NbTaps = 2 * RADIUS;
+    constexpr unsigned int Channels = BITMAP::Channels;
+
+    // Tolerance for the rounding errors at the borders of the source bitmap
+    constexpr double Epsilon = 1e-6;
+
+    const int width = (int) source->width();
+    const int height = (int) source->height();
+    const double maxX = double(width - 1) + Epsilon;
+    const double maxY = double(height - 1) + Epsilon;
+
+    for (unsigned int x = 0; x < count; ++x, dest += Channels)
+    {
+        const double sx = xs[x];
+        const double sy = ys[x];
+
+        if ((sx < -Epsilon) || (sy < -Epsilon) || (sx > maxX) || (sy > maxY))
+        {
+            for (unsigned int c = 0; c < Channels; ++c)
+                dest[c] = type_t(0);
+
+            continue;
+        }
+
+        const int x0 = (int) std::floor(sx);
+        const int y0 = (int) std::floor(sy);
+
+        double wx[NbTaps];
+        double wy[NbTaps];
+        kernel(sx - x0, wx);
+        kernel(sy - y0, wy);
+
+        // The pixels outside of the source bitmap are replaced by the nearest border
+        int columns[NbTaps];
+        for (int i = 0; i < NbTaps; ++i)
+            columns[i] = std::clamp(x0 - RADIUS + 1 + i, 0, width - 1) * Channels;
+
+        double sums[Channels] = { 0.0 };
+
+        for (int j = 0; j < NbTaps; ++j)
+        {
+            const type_t* row = source->data(std::clamp(y0 - RADIUS + 1 + j, 0, height - 1));
+
+            double rowSums[Channels] = { 0.0 };
+
+            for (int i = 0; i < NbTaps; ++i)
+            {
+                const type_t* src = row + columns[i];
+
+                for (unsigned int c = 0; c < Channels; ++c)
+                    rowSums[c] += wx[i] * double(src[c]);
+            }
+
+            for (unsigned int c = 0; c < Channels; ++c)
+                sums[c] += wy[j] * rowSums[c];
+        }
+
+        for (unsigned int c = 0; c < Channels; ++c)
+            dest[c] = toValue<type_t>(sums[c]);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+template<typename T>
+inline T Transformation::toValue(double value) noexcept
+{
+    // Bicubic and Lanczos kernels can overshoot: clamp to the valid values
+    if constexpr (std::is_integral_v<T>)
+        return T(std::clamp(value + 0.5, 0.0, double(std::numeric_limits<T>::max())));
+    else
+        return T(std::max(value, 0.0));
+}
+
+//-----------------------------------------------------------------------------
+
+inline void Transformation::bilinearWeights(double t, double* weights) noexcept
+{
+    weights[0] = 1.0 - t;
+    weights[1] = t;
+}
+
+//-----------------------------------------------------------------------------
+
+inline void Transformation::bicubicWeights(double t, double* weights) noexcept
+{
+    // Catmull-Rom spline
+    const double t2 = t * t;
+    const double t3 = t2 * t;
+
+    weights[0] = -0.5 * t3 + t2 - 0.5 * t;
+    weights[1] = 1.5 * t3 - 2.5 * t2 + 1.0;
+    weights[2] = -1.5 * t3 + 2.0 * t2 + 0.5 * t;
+    weights[3] = 0.5 * t3 - 0.5 * t2;
+}
+
+//-----------------------------------------------------------------------------
+
+inline void Transformation::lanczos3Weights(double t, double* weights) noexcept
+{
+    double total = 0.0;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const double d = std::abs(double(i - 2) - t);
+
+        if (d < 1e-9)
+        {
+            weights[i] = 1.0;
+        }
+        else if (d >= 3.0)
+        {
+            weights[i] = 0.0;
+        }
+        else
+        {
+            const double pd = M_PI * d;
+            weights[i] = 3.0 * std::sin(pd) * std::sin(pd / 3.0) / (pd * pd);
+        }
+
+        total += weights[i];
+    }
+
+    // Normalise, so flat areas are preserved
+    for (int i = 0; i < 6; ++i)
+        weights[i] /= total;
+}
+
+}
@@ -27,6 +27,16 @@ namespace astrophototoolbox {
     DoubleGrayBitmap* computeLuminanceBitmap(Bitmap* bitmap);
 
 
+    //------------------------------------------------------------------------------------
+    /// @brief  Compute the luminance component of a bitmap, with a single-precision
+    ///         floating-point bitmap
+    ///
+    /// Needs half the memory of 'computeLuminanceBitmap()', which is enough when the
+    /// luminance is only used to detect stars.
+    //------------------------------------------------------------------------------------
+    FloatGrayBitmap* computeFloatLuminanceBitmap(Bitmap* bitmap);
+
+
     //------------------------------------------------------------------------------------
     /// @brief  Compute the median of a bitmap
     //------------------------------------------------------------------------------------
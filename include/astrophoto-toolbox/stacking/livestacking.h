@@ -174,6 +174,16 @@ namespace stacking {
         //--------------------------------------------------------------------------------
         bool start();
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Request the computation of the exact stacked image
+        ///
+        /// While running, the stacked image is only updated incrementally (as an
+        /// approximation) each time new light frames are stacked. The exact one (median
+        /// of all the stacked light frames) is computed on request, and when the live
+        /// stacking is stopped. The listener is notified as usual when it is available.
+        //--------------------------------------------------------------------------------
+        void computeExactStacking();
+
         //--------------------------------------------------------------------------------
         /// @brief  Cancel the live stacking (blocking call)
         ///
@@ -75,7 +75,7 @@ bool LiveStacking<BITMAP>::setup(
         lightFramesThread = new threads::LightFrameThread<BITMAP>(this, folder / CALIBRATED_LIGHT_FRAMES_PATH);
         registrationThread = new threads::RegistrationThread<BITMAP>(this, folder / CALIBRATED_LIGHT_FRAMES_PATH);
         stackingThread = new threads::StackingThread<BITMAP>(this, folder / STACKED_FILE);
-        stackingThread->setup(10, folder / STACKING_TEMP_PATH);
+        stackingThread->setup(10, folder / STACKING_TEMP_PATH, 50000000L, true);
     }
 
     return true;
@@ -461,6 +461,15 @@ bool LiveStacking<BITMAP>::start()
 
 //-----------------------------------------------------------------------------
 
+template<class BITMAP>
+void LiveStacking<BITMAP>::computeExactStacking()
+{
+    if (stackingThread)
+        stackingThread->computeExactStacking();
+}
+
+//-----------------------------------------------------------------------------
+
 template<class BITMAP>
 void LiveStacking<BITMAP>::cancel()
 {
@@ -513,6 +522,8 @@ void LiveStacking<BITMAP>::stop()
     registrationThread->stop();
     registrationThread->join();
 
+    // The final stacked image must be exact
+    stackingThread->computeExactStacking();
     stackingThread->stop();
     stackingThread->join();
 
@@ -11,7 +11,10 @@
 #include <astrophoto-toolbox/images/bitmap.h>
 #include <astrophoto-toolbox/stacking/utils/registration.h>
 #include <astrophoto-toolbox/stacking/utils/starmatcher.h>
+#include <astrophoto-toolbox/stacking/utils/motionpredictor.h>
 #include <filesystem>
+#include <mutex>
+#include <vector>
 
 
 namespace astrophototoolbox {
@@ -33,6 +36,21 @@ namespace processing {
         //--------------------------------------------------------------------------------
         void setParameters(const star_list_t& stars, int luminancyThreshold);
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Enable or disable the prediction of the transformation of each light
+        ///         frame from the ones of the previous frames
+        ///
+        /// Meant to be used when the light frames are registered in the order they were
+        /// taken (like during live stacking): the stars are first paired using the
+        /// predicted transformation, which is faster than matching triangles of stars.
+        /// Not used by the registration of several frames in parallel.
+        //--------------------------------------------------------------------------------
+        inline void setMotionPrediction(bool enabled)
+        {
+            motionPrediction = enabled;
+            predictor.clear();
+        }
+
         //--------------------------------------------------------------------------------
         /// @brief  Register the light frame file to use as the reference, and save the
         ///         list of detected stars at the given destination path
@@ -97,12 +115,54 @@ namespace processing {
             const std::filesystem::path& destination = ""
         );
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Register a list of light frame files in parallel, and save the lists
+        ///         of detected stars and the transformations from the reference frame at
+        ///         the given destination paths
+        ///
+        /// The frames are distributed between 'nbThreads' worker threads (0 means 'as
+        /// many as the hardware supports'), each one detecting the stars and matching
+        /// them with the ones of the reference frame. The index of the reference stars
+        /// is shared by all the workers.
+        ///
+        /// The results are returned in the same order than the light frames. The stars
+        /// of the frames that couldn't be registered are empty.
+        ///
+        /// If not empty, 'destinations' must contain one path per light frame (see the
+        /// single-frame method for details).
+        ///
+        /// It is expected that the light frames have been properly processed.
+        //--------------------------------------------------------------------------------
+        std::vector<std::tuple<star_list_t, Transformation>> process(
+            const std::vector<std::filesystem::path>& lightFrames,
+            const std::vector<std::filesystem::path>& destinations = {},
+            unsigned int nbThreads = 0
+        );
+
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  Register a light frame bitmap using the provided objects
+        ///
+        /// If provided, the predictor is used (and updated), and the mutex is locked
+        /// while the destination file is written.
+        //--------------------------------------------------------------------------------
+        std::tuple<star_list_t, Transformation> registerFrame(
+            const std::shared_ptr<BITMAP>& lightFrame,
+            const std::filesystem::path& destination, utils::Registration& registration,
+            utils::StarMatcher& matcher, utils::MotionPredictor* predictor = nullptr,
+            std::mutex* ioMutex = nullptr
+        );
+
 
     private:
         utils::Registration registration;
         int luminancyThreshold = -1;
         utils::StarMatcher matcher;
         star_list_t referenceStars;
+        utils::stars_index_ptr_t referenceIndex;
+        bool motionPrediction = false;
+        utils::MotionPredictor predictor;
     };
 
 }
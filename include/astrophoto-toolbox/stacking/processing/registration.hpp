@@ -9,6 +9,8 @@
 #include <astrophoto-toolbox/stacking/processing/registration.h>
 #include <astrophoto-toolbox/images/io.h>
 #include <astrophoto-toolbox/data/fits.h>
+#include <atomic>
+#include <thread>
 
 using namespace astrophototoolbox;
 using namespace stacking;
@@ -19,6 +21,8 @@ template<class BITMAP>
 void RegistrationProcessor<BITMAP>::setParameters(const star_list_t& stars, int luminancyThreshold)
 {
     referenceStars = stars;
+    referenceIndex = std::make_shared<utils::StarsIndex>(referenceStars);
+    predictor.clear();
     this->luminancyThreshold = luminancyThreshold;
 }
 
@@ -31,6 +35,8 @@ star_list_t RegistrationProcessor<BITMAP>::processReference(
 )
 {
     referenceStars.clear();
+    referenceIndex.reset();
+    predictor.clear();
 
     Bitmap* bitmap = io::load(lightFrame);
     if (!bitmap)
@@ -48,6 +54,8 @@ star_list_t RegistrationProcessor<BITMAP>::processReference(
 )
 {
     referenceStars = registration.registerBitmap(lightFrame.get(), luminancyThreshold);
+    referenceIndex = std::make_shared<utils::StarsIndex>(referenceStars);
+    predictor.clear();
     this->luminancyThreshold = registration.getLuminancyThreshold();
 
     if (!destination.empty())
@@ -101,18 +109,112 @@ template<class BITMAP>
 std::tuple<star_list_t, Transformation> RegistrationProcessor<BITMAP>::process(
     const std::shared_ptr<BITMAP>& lightFrame, const std::filesystem::path& destination
 )
+{
+    return registerFrame(
+        lightFrame, destination, registration, matcher,
+        (motionPrediction ? &predictor : nullptr)
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+std::vector<std::tuple<star_list_t, Transformation>> RegistrationProcessor<BITMAP>::process(
+    const std::vector<std::filesystem::path>& lightFrames,
+    const std::vector<std::filesystem::path>& destinations, unsigned int nbThreads
+)
+{
+    std::vector<std::tuple<star_list_t, Transformation>> results(lightFrames.size());
+
+    if (lightFrames.empty() || (!destinations.empty() && (destinations.size() != lightFrames.size())))
+        return results;
+
+    if (nbThreads == 0)
+        nbThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    nbThreads = std::min(nbThreads, (unsigned int) lightFrames.size());
+
+    // The files are accessed one at a time, the registration of the frames is done in
+    // parallel
+    std::atomic<size_t> nextFrame = 0;
+    std::mutex ioMutex;
+
+    auto worker = [&]()
+    {
+        utils::Registration registration;
+        utils::StarMatcher matcher;
+
+        // The frames are already processed in parallel
+        registration.setNbThreads(1);
+
+        while (true)
+        {
+            const size_t index = nextFrame++;
+            if (index >= lightFrames.size())
+                break;
+
+            std::shared_ptr<BITMAP> lightFrame;
+
+            {
+                std::lock_guard<std::mutex> lock(ioMutex);
+
+                Bitmap* bitmap = io::load(lightFrames[index]);
+                if (bitmap)
+                    lightFrame = std::make_shared<BITMAP>(bitmap);
+            }
+
+            if (!lightFrame)
+                continue;
+
+            results[index] = registerFrame(
+                lightFrame, (!destinations.empty() ? destinations[index] : ""),
+                registration, matcher, nullptr, &ioMutex
+            );
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < nbThreads; ++i)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return results;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+std::tuple<star_list_t, Transformation> RegistrationProcessor<BITMAP>::registerFrame(
+    const std::shared_ptr<BITMAP>& lightFrame, const std::filesystem::path& destination,
+    utils::Registration& registration, utils::StarMatcher& matcher,
+    utils::MotionPredictor* predictor, std::mutex* ioMutex
+)
 {
     star_list_t stars = registration.registerBitmap(lightFrame.get(), luminancyThreshold);
 
     Transformation transformation;
+    Transformation prediction;
+
+    const bool predicted = (predictor && predictor->predict(prediction));
 
     bool valid = matcher.computeTransformation(
-        stars, referenceStars, size2d_t(lightFrame->width(), lightFrame->height()),
-        transformation
+        stars, referenceIndex, size2d_t(lightFrame->width(), lightFrame->height()),
+        transformation, 0.0, (predicted ? &prediction : nullptr)
     );
 
+    if (valid && predictor)
+        predictor->add(transformation);
+
     if (!destination.empty())
     {
+        std::unique_lock<std::mutex> lock;
+        if (ioMutex)
+            lock = std::unique_lock<std::mutex>(*ioMutex);
+
         FITS fits;
 
         if (std::filesystem::exists(destination))
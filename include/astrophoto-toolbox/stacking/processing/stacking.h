@@ -10,7 +10,9 @@
 
 #include <astrophoto-toolbox/images/bitmap.h>
 #include <astrophoto-toolbox/data/point.h>
+#include <astrophoto-toolbox/algorithms/workerpool.h>
 #include <astrophoto-toolbox/stacking/utils/bitmapstacker.h>
+#include <astrophoto-toolbox/stacking/utils/incrementalstacker.h>
 #include <filesystem>
 
 
@@ -27,11 +29,19 @@ namespace processing {
     public:
         //--------------------------------------------------------------------------------
         /// @brief  Setup the stacker
+        ///
+        /// In incremental mode, an approximation of the stacked frame is also maintained
+        /// each time a frame is added (see 'process()').
+        ///
+        /// 'memoryBudget' is the maximum amount of memory (in bytes) used to hold the
+        /// frames during stacking (see BitmapStacker::setup()).
         //--------------------------------------------------------------------------------
         void setup(
             unsigned int nbExpectedFrames,
             const std::filesystem::path& tempFolder = "",
-            unsigned long maxFileSize = 50000000L
+            unsigned long maxFileSize = 50000000L,
+            bool incremental = false,
+            unsigned long memoryBudget = 1000000000L
         );
 
         //--------------------------------------------------------------------------------
@@ -61,8 +71,12 @@ namespace processing {
         /// Several files need to be written during the processing, so the caller has to
         /// specify a temp folder to user (it will be created and destroyed by this
         /// method).
+        ///
+        /// In incremental mode, if 'exact' is false, the approximation maintained while
+        /// adding the frames is returned instead, which is much faster (the cost doesn't
+        /// depend on the number of frames).
         //--------------------------------------------------------------------------------
-        BITMAP* process(const std::filesystem::path& destination = "");
+        BITMAP* process(const std::filesystem::path& destination = "", bool exact = true);
 
         //--------------------------------------------------------------------------------
         /// @brief  Cancel the processing
@@ -87,7 +101,10 @@ namespace processing {
 
     private:
         utils::BitmapStacker<BITMAP> stacker;
+        utils::IncrementalStacker<BITMAP> incrementalStacker;
+        bool incremental = false;
         rect_t outputRect;
+        WorkerPool workers;     // Used to transform the frames, band by band
     };
 
 }
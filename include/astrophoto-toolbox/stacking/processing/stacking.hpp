@@ -18,10 +18,13 @@ namespace processing {
 template<class BITMAP>
 void FramesStacker<BITMAP>::setup(
     unsigned int nbExpectedFrames, const std::filesystem::path& tempFolder,
-    unsigned long maxFileSize
+    unsigned long maxFileSize, bool incremental, unsigned long memoryBudget
 )
 {
-    stacker.setup(nbExpectedFrames, tempFolder, maxFileSize);
+    stacker.setup(nbExpectedFrames, tempFolder, maxFileSize, memoryBudget);
+
+    incrementalStacker.clear();
+    this->incremental = incremental;
 
     outputRect = rect_t(
         0, 0, std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()
@@ -49,24 +52,46 @@ bool FramesStacker<BITMAP>::addFrame(
     const std::shared_ptr<BITMAP>& lightFrame, const Transformation& transformation
 )
 {
-    rect_t transformedRect = transformation.transform(
+    // Only the part of the image covered by the transformed frame is valid
+    const rect_t validRect = transformation.transform(
+        rect_t{ 0, 0, (int) lightFrame->width(), (int) lightFrame->height() }
+    ).intersection(
         rect_t{ 0, 0, (int) lightFrame->width(), (int) lightFrame->height() }
     );
 
-    if ((transformedRect.left < transformedRect.right) &&
-        (transformedRect.top < transformedRect.bottom))
+    if ((validRect.left < validRect.right) && (validRect.top < validRect.bottom))
     {
-        auto* transformed = transformation.transform(lightFrame.get());
-        
-        if (!stacker.addBitmap(transformed))
-        {
-            delete transformed;
+        // The frame is transformed band by band, directly into the storage of the
+        // stacker(s), without any intermediate bitmap. The kind of the transformation
+        // and the threads are the same for all the bands.
+        const BITMAP* frame = lightFrame.get();
+        const transformation_class_t kind = transformation.classify(
+            size2d_t(frame->width(), frame->height())
+        );
+
+        if (incremental)
+            incrementalStacker.beginBitmap(frame->width(), frame->height(), frame->range());
+
+        const bool added = stacker.addBitmap(
+            frame->width(), frame->height(), frame->range(), validRect,
+            [&](const rect_t& area, typename BITMAP::type_t* rows)
+            {
+                transformation.transform(
+                    frame, rows, area, kind, INTERPOLATION_BILINEAR, workers
+                );
+
+                if (incremental)
+                    incrementalStacker.addRows(area, rows);
+            }
+        );
+
+        if (incremental)
+            incrementalStacker.endBitmap();
+
+        if (!added)
             return false;
-        }
 
-        outputRect = outputRect.intersection(transformedRect);
-
-        delete transformed;
+        outputRect = outputRect.intersection(validRect);
 
         return true;
     }
@@ -77,22 +102,37 @@ bool FramesStacker<BITMAP>::addFrame(
 //-----------------------------------------------------------------------------
 
 template<class BITMAP>
-BITMAP* FramesStacker<BITMAP>::process(const std::filesystem::path& destination)
+BITMAP* FramesStacker<BITMAP>::process(const std::filesystem::path& destination, bool exact)
 {
-    BITMAP* stacked = stacker.process();
-    if (!stacked)
+    if ((outputRect.width() <= 0) || (outputRect.height() <= 0))
         return nullptr;
 
-    BITMAP* result = new BITMAP(outputRect.width(), outputRect.height());
-    for (unsigned int y = 0; y < result->height(); ++y)
+    BITMAP* result = nullptr;
+
+    if (incremental && !exact)
     {
-        typename BITMAP::type_t* src = stacked->data(outputRect.left, outputRect.top + y);
-        typename BITMAP::type_t* dest = result->data(y);
+        BITMAP* stacked = incrementalStacker.process();
+        if (!stacked)
+            return nullptr;
 
-        memcpy(dest, src, result->bytesPerRow());
-    }
+        result = new BITMAP(outputRect.width(), outputRect.height());
+        for (unsigned int y = 0; y < result->height(); ++y)
+        {
+            typename BITMAP::type_t* src = stacked->data(outputRect.left, outputRect.top + y);
+            typename BITMAP::type_t* dest = result->data(y);
+
+            memcpy(dest, src, result->bytesPerRow());
+        }
 
-    delete stacked;
+        delete stacked;
+    }
+    else
+    {
+        // Only the area common to all the frames is stacked
+        result = stacker.process(outputRect);
+        if (!result)
+            return nullptr;
+    }
 
     if (!destination.empty() && !io::save(destination, result, true))
     {
@@ -117,6 +157,7 @@ template<class BITMAP>
 void FramesStacker<BITMAP>::clear()
 {
     stacker.clear();
+    incrementalStacker.clear();
 
     outputRect = rect_t(
         0, 0, std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()
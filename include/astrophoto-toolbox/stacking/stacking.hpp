@@ -213,19 +213,28 @@ BITMAP* Stacking<BITMAP>::process(int luminancyThreshold)
     if (stars.empty())
         return nullptr;
 
-    std::vector<std::filesystem::path> toStack;
-    toStack.push_back(filename);
+    // Register all the other frames in parallel
+    std::vector<std::filesystem::path> toRegister;
 
     for (unsigned int i = 0; i < lightFrames.size(); ++i)
     {
         if (i == referenceFrame)
             continue;
 
-        auto filename = folder / CALIBRATED_LIGHT_FRAMES_PATH / getCalibratedFilename(lightFrames[i]);
+        toRegister.push_back(
+            folder / CALIBRATED_LIGHT_FRAMES_PATH / getCalibratedFilename(lightFrames[i])
+        );
+    }
+
+    auto results = registrationProcessor.process(toRegister, toRegister);
 
-        auto result = registrationProcessor.process(filename, filename);
-        if (!get<0>(result).empty())
-            toStack.push_back(filename);
+    std::vector<std::filesystem::path> toStack;
+    toStack.push_back(filename);
+
+    for (size_t i = 0; i < toRegister.size(); ++i)
+    {
+        if (!get<0>(results[i]).empty())
+            toStack.push_back(toRegister[i]);
     }
 
     framesStacker.setup(toStack.size(), folder / STACKING_TEMP_PATH);
@@ -19,6 +19,9 @@ RegistrationThread<BITMAP>::RegistrationThread(
 )
 : listener(listener), destFolder(destFolder)
 {
+    // The light frames are registered in the order they were taken
+    processor.setMotionPrediction(true);
+
     if (!std::filesystem::exists(destFolder))
         std::filesystem::create_directories(destFolder);
 }
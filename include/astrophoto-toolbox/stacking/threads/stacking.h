@@ -44,12 +44,20 @@ namespace threads {
         //--------------------------------------------------------------------------------
         /// @brief  Setup the stacker
         ///
+        /// In incremental mode, each new batch of frames only updates an approximation of
+        /// the stacked frame (without recomputing the median of all the frames), and the
+        /// exact stacking is only done on request (see 'computeExactStacking()').
+        ///
+        /// See 'FramesStacker::setup()' for 'maxFileSize' and 'memoryBudget'.
+        ///
         /// It is expected that the thread isn't already running.
         //--------------------------------------------------------------------------------
         bool setup(
             unsigned int nbExpectedFrames,
             const std::filesystem::path& tempFolder,
-            unsigned long maxFileSize = 50000000L
+            unsigned long maxFileSize = 50000000L,
+            bool incremental = false,
+            unsigned long memoryBudget = 1000000000L
         );
 
         //--------------------------------------------------------------------------------
@@ -59,6 +67,13 @@ namespace threads {
         //--------------------------------------------------------------------------------
         void processFrames(const std::vector<std::filesystem::path>& lightFrames);
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Request the exact stacking of all the frames added so far
+        ///
+        /// Only useful in incremental mode.
+        //--------------------------------------------------------------------------------
+        void computeExactStacking();
+
 
     private:
         void process() override;
@@ -74,6 +89,8 @@ namespace threads {
         processing::FramesStacker<BITMAP> stacker;
 
         std::vector<std::filesystem::path> lightFrames;
+        bool incremental = false;
+        bool exactStackingRequested = false;
     };
 
 }
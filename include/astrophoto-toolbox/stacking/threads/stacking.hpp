@@ -33,13 +33,15 @@ StackingThread<BITMAP>::~StackingThread()
 template<class BITMAP>
 bool StackingThread<BITMAP>::setup(
     unsigned int nbExpectedFrames, const std::filesystem::path& tempFolder,
-    unsigned long maxFileSize
+    unsigned long maxFileSize, bool incremental, unsigned long memoryBudget
 )
 {
     if (thread.joinable())
         return false;
 
-    stacker.setup(nbExpectedFrames, tempFolder, maxFileSize);
+    stacker.setup(nbExpectedFrames, tempFolder, maxFileSize, incremental, memoryBudget);
+    this->incremental = incremental;
+    exactStackingRequested = false;
 
     return true;
 }
@@ -60,12 +62,24 @@ void StackingThread<BITMAP>::processFrames(const std::vector<std::filesystem::pa
 
 //-----------------------------------------------------------------------------
 
+template<class BITMAP>
+void StackingThread<BITMAP>::computeExactStacking()
+{
+    mutex.lock();
+    exactStackingRequested = true;
+    mutex.unlock();
+    condition.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+
 template<class BITMAP>
 void StackingThread<BITMAP>::process()
 {
     auto jobAvailable = [this]{
-        return !lightFrames.empty() || (state == STATE_CANCELLING) ||
-               (state == STATE_STOPPING) || (state == STATE_RESETTING);
+        return !lightFrames.empty() || exactStackingRequested ||
+               (state == STATE_CANCELLING) || (state == STATE_STOPPING) ||
+               (state == STATE_RESETTING);
     };
 
     while (true)
@@ -79,6 +93,7 @@ void StackingThread<BITMAP>::process()
         {
             lightFrames.clear();
             stacker.clear();
+            exactStackingRequested = false;
             state = STATE_RUNNING;
             latch->count_down();
             continue;
@@ -90,14 +105,20 @@ void StackingThread<BITMAP>::process()
             break;
         }
 
-        if ((state == STATE_STOPPING) && lightFrames.empty())
+        if ((state == STATE_STOPPING) && lightFrames.empty() && !exactStackingRequested)
             break;
 
         auto filenames = lightFrames;
         lightFrames.clear();
 
+        const bool exact = !incremental || exactStackingRequested;
+        exactStackingRequested = false;
+
         lock.unlock();
 
+        if (filenames.empty() && (stacker.nbFrames() == 0))
+            continue;
+
         listener->lightFramesStackingStarted(stacker.nbFrames() + filenames.size());
 
         // Stack the frames
@@ -112,7 +133,7 @@ void StackingThread<BITMAP>::process()
         if ((state == STATE_CANCELLING) || (state == STATE_RESETTING))
             continue;
 
-        BITMAP* bitmap = stacker.process(destFilename);
+        BITMAP* bitmap = stacker.process(destFilename, exact);
         if (bitmap)
         {
             if ((state != STATE_CANCELLING) && (state != STATE_RESETTING))
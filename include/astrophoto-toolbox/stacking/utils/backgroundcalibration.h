@@ -9,6 +9,8 @@
 #pragma once
 
 #include <astrophoto-toolbox/images/bitmap.h>
+#include <astrophoto-toolbox/algorithms/histogram.h>
+#include <astrophoto-toolbox/algorithms/interpolation.h>
 
 
 namespace astrophototoolbox {
@@ -64,6 +66,27 @@ namespace utils {
             return parameters;
         }
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Set the number of threads used to compute the histograms of the
+        ///         bitmaps (0: one per hardware thread)
+        //--------------------------------------------------------------------------------
+        inline void setNbThreads(unsigned int nbThreads)
+        {
+            this->nbThreads = nbThreads;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Only use one pixel every 'step' pixels (in both directions) to compute
+        ///         the background values of the bitmaps
+        ///
+        /// The maximum values are always computed from all the pixels. With a step of 1
+        /// (the default), the background values are exact.
+        //--------------------------------------------------------------------------------
+        inline void setSubsampling(unsigned int step)
+        {
+            subsampling = std::max(step, 1u);
+        }
+
         //--------------------------------------------------------------------------------
         /// @brief  Apply background calibration to a bitmap
         ///
@@ -88,9 +111,26 @@ namespace utils {
             const BITMAP* bitmap, background_calibration_parameters_t& parameters
         ) const requires(BITMAP::Channels == 1);
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Apply the interpolation of each channel to a bitmap
+        //--------------------------------------------------------------------------------
+        static void apply(BITMAP* bitmap, const Interpolation* interpolations);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the histograms of all the channels of a bitmap in one pass
+        ///
+        /// Also returns the bin of the maximum value of each channel, and the number of
+        /// pixels in each histogram.
+        //--------------------------------------------------------------------------------
+        size_t computeHistograms(
+            const BITMAP* bitmap, histogram_t* histograms, size_t* maxBins
+        ) const;
+
 
     private:
         background_calibration_parameters_t parameters;
+        unsigned int nbThreads = 0;
+        unsigned int subsampling = 1;
     };
 
 }
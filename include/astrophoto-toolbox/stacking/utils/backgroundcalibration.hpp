@@ -17,6 +17,10 @@
 
 #include <astrophoto-toolbox/algorithms/histogram.h>
 #include <astrophoto-toolbox/algorithms/interpolation.h>
+#include <array>
+#include <numeric>
+#include <thread>
+#include <type_traits>
 
 
 namespace astrophototoolbox {
@@ -38,32 +42,22 @@ void BackgroundCalibration<BITMAP>::calibrate(BITMAP* bitmap) const requires(BIT
 
     computeParameters(bitmap, src);
 
-    Interpolation redInterpolation(
-        0.0, src.redBackground, src.redMax,
-        0.0, parameters.redBackground, parameters.redMax
-    );
-
-    Interpolation greenInterpolation(
-        0.0, src.greenBackground, src.greenMax,
-        0.0, parameters.greenBackground, parameters.greenMax
-    );
-
-    Interpolation blueInterpolation(
-        0.0, src.blueBackground, src.blueMax,
-        0.0, parameters.blueBackground, parameters.blueMax
-    );
-
-    for (unsigned int y = 0; y < bitmap->height(); ++y)
-    {
-        typename BITMAP::type_t* data = bitmap->data(y);
+    const Interpolation interpolations[3] = {
+        Interpolation(
+            0.0, src.redBackground, src.redMax,
+            0.0, parameters.redBackground, parameters.redMax
+        ),
+        Interpolation(
+            0.0, src.greenBackground, src.greenMax,
+            0.0, parameters.greenBackground, parameters.greenMax
+        ),
+        Interpolation(
+            0.0, src.blueBackground, src.blueMax,
+            0.0, parameters.blueBackground, parameters.blueMax
+        ),
+    };
 
-        for (unsigned int x = 0, i = 0; x < bitmap->width(); ++x, i += 3)
-        {
-            data[i] = redInterpolation.interpolate(data[i]);
-            data[i + 1] = greenInterpolation.interpolate(data[i + 1]);
-            data[i + 2] = blueInterpolation.interpolate(data[i + 2]);
-        }
-    }
+    apply(bitmap, interpolations);
 }
 
 //-----------------------------------------------------------------------------
@@ -80,12 +74,61 @@ void BackgroundCalibration<BITMAP>::calibrate(BITMAP* bitmap) const requires(BIT
         0.0, parameters.redBackground, parameters.redMax
     );
 
-    for (unsigned int y = 0; y < bitmap->height(); ++y)
+    apply(bitmap, &interpolation);
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void BackgroundCalibration<BITMAP>::apply(
+    BITMAP* bitmap, const Interpolation* interpolations
+)
+{
+    typedef typename BITMAP::type_t type_t;
+
+    constexpr unsigned int Channels = BITMAP::Channels;
+
+    const unsigned int width = bitmap->width();
+    const unsigned int height = bitmap->height();
+
+    // For 8- and 16-bit bitmaps big enough, interpolate all the possible values once, and
+    // use lookup tables
+    if constexpr (std::is_integral_v<type_t> && (sizeof(type_t) <= 2))
+    {
+        constexpr size_t NbValues = size_t(std::numeric_limits<type_t>::max()) + 1;
+
+        if (size_t(width) * height > NbValues)
+        {
+            std::vector<type_t> lookupTables[Channels];
+
+            for (unsigned int c = 0; c < Channels; ++c)
+            {
+                lookupTables[c].resize(NbValues);
+                std::iota(lookupTables[c].begin(), lookupTables[c].end(), type_t(0));
+                interpolations[c].interpolate(lookupTables[c].data(), NbValues);
+            }
+
+            for (unsigned int y = 0; y < height; ++y)
+            {
+                type_t* data = bitmap->data(y);
+
+                for (unsigned int i = 0; i < width * Channels; i += Channels)
+                {
+                    for (unsigned int c = 0; c < Channels; ++c)
+                        data[i + c] = lookupTables[c][data[i + c]];
+                }
+            }
+
+            return;
+        }
+    }
+
+    for (unsigned int y = 0; y < height; ++y)
     {
-        typename BITMAP::type_t* data = bitmap->data(y);
+        type_t* data = bitmap->data(y);
 
-        for (unsigned int x = 0; x < bitmap->width(); ++x)
-            data[x] = interpolation.interpolate(data[x]);
+        for (unsigned int c = 0; c < Channels; ++c)
+            interpolations[c].interpolate(data + c, width, Channels);
     }
 }
 
@@ -97,33 +140,18 @@ void BackgroundCalibration<BITMAP>::computeParameters(
 ) const requires(BITMAP::Channels == 3)
 {
     // Compute one histogram per channel
-    histogram_t redHistogram;
-    histogram_t greenHistogram;
-    histogram_t blueHistogram;
+    histogram_t histograms[3];
+    size_t maxBins[3];
 
-    computeHistogram(bitmap, redHistogram, 0);
-    computeHistogram(bitmap, greenHistogram, 1);
-    computeHistogram(bitmap, blueHistogram, 2);
+    const size_t nbSamples = computeHistograms(bitmap, histograms, maxBins);
 
     // Retrieve the maximum value of each channel
-    const auto findMax = [](const histogram_t& histogram) -> double
-    {
-        size_t i = histogram.size() - 1;
-        for (auto it = histogram.crbegin(); it != histogram.crend(); ++it, --i)
-        {
-            if (*it != 0)
-                return static_cast<double>(i) / 65535.0;
-        }
-
-        return 0.0;
-    };
-
-    parameters.redMax = findMax(redHistogram) * bitmap->maxRangeValue();
-    parameters.greenMax = findMax(greenHistogram) * bitmap->maxRangeValue();
-    parameters.blueMax = findMax(blueHistogram) * bitmap->maxRangeValue();
+    parameters.redMax = static_cast<double>(maxBins[0]) / 65535.0 * bitmap->maxRangeValue();
+    parameters.greenMax = static_cast<double>(maxBins[1]) / 65535.0 * bitmap->maxRangeValue();
+    parameters.blueMax = static_cast<double>(maxBins[2]) / 65535.0 * bitmap->maxRangeValue();
 
     // Compute the median of each channel
-    const auto findMedian = [nbTotalValues = (bitmap->width() * bitmap->height()) / 2](const histogram_t& histogram) -> double
+    const auto findMedian = [nbTotalValues = nbSamples / 2](const histogram_t& histogram) -> double
     {
         size_t nbValues = 0;
         size_t index = 0;
@@ -133,9 +161,9 @@ void BackgroundCalibration<BITMAP>::computeParameters(
         return double(index) / 65535.0;
     };
 
-    parameters.redBackground = findMedian(redHistogram) * bitmap->maxRangeValue();
-    parameters.greenBackground = findMedian(greenHistogram) * bitmap->maxRangeValue();
-    parameters.blueBackground = findMedian(blueHistogram) * bitmap->maxRangeValue();
+    parameters.redBackground = findMedian(histograms[0]) * bitmap->maxRangeValue();
+    parameters.greenBackground = findMedian(histograms[1]) * bitmap->maxRangeValue();
+    parameters.blueBackground = findMedian(histograms[2]) * bitmap->maxRangeValue();
 }
 
 //-----------------------------------------------------------------------------
@@ -147,26 +175,15 @@ void BackgroundCalibration<BITMAP>::computeParameters(
 {
     // Compute the histogram
     histogram_t histogram;
+    size_t maxBin;
 
-    computeHistogram(bitmap, histogram);
+    const size_t nbSamples = computeHistograms(bitmap, &histogram, &maxBin);
 
     // Retrieve the maximum value of the channel
-    const auto findMax = [](const histogram_t& histogram) -> double
-    {
-        size_t i = histogram.size() - 1;
-        for (auto it = histogram.crbegin(); it != histogram.crend(); ++it, --i)
-        {
-            if (*it != 0)
-                return static_cast<double>(i) / 65535.0;
-        }
-
-        return 0.0;
-    };
-
-    parameters.redMax = findMax(histogram) * bitmap->maxRangeValue();
+    parameters.redMax = static_cast<double>(maxBin) / 65535.0 * bitmap->maxRangeValue();
 
-    // Compute the median of each channel
-    const auto findMedian = [nbTotalValues = (bitmap->width() * bitmap->height()) / 2](const histogram_t& histogram) -> double
+    // Compute the median of the channel
+    const auto findMedian = [nbTotalValues = nbSamples / 2](const histogram_t& histogram) -> double
     {
         size_t nbValues = 0;
         size_t index = 0;
@@ -179,6 +196,152 @@ void BackgroundCalibration<BITMAP>::computeParameters(
     parameters.redBackground = findMedian(histogram) * bitmap->maxRangeValue();
 }
 
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+size_t BackgroundCalibration<BITMAP>::computeHistograms(
+    const BITMAP* bitmap, histogram_t* histograms, size_t* maxBins
+) const
+{
+    typedef typename BITMAP::type_t type_t;
+
+    constexpr unsigned int Channels = BITMAP::Channels;
+    constexpr size_t NbBins = size_t(std::numeric_limits<uint16_t>::max()) + 1;
+
+    const unsigned int width = bitmap->width();
+    const unsigned int height = bitmap->height();
+    const type_t maxValue = (type_t) bitmap->maxRangeValue();
+
+    // Each worker processes a band of rows, with its own histograms: 32-bit counters
+    // are enough for one band, and halve the memory to clear and merge
+    unsigned int nbWorkers = (nbThreads != 0 ? nbThreads : std::thread::hardware_concurrency());
+    nbWorkers = std::max(std::min(nbWorkers, (height + subsampling - 1) / subsampling), 1u);
+
+    std::vector<std::vector<uint32_t>> counts(nbWorkers);
+    std::vector<std::array<type_t, Channels>> maxValues(nbWorkers);
+
+    const auto process = [&](auto bin)
+    {
+        const auto worker = [&](unsigned int index)
+        {
+            counts[index].assign(Channels * NbBins, 0);
+
+            uint32_t* histogram = counts[index].data();
+
+            // Local copies, so they aren't reloaded after each write into the histograms
+            const unsigned int rowSize = width * Channels;
+            const unsigned int step = subsampling;
+            const unsigned int startRow = height * index / nbWorkers;
+            const unsigned int endRow = height * (index + 1) / nbWorkers;
+
+            // When subsampling, the maximum values must still be computed from all the
+            // pixels: use several maximums per channel, so the loop can be vectorized
+            constexpr unsigned int NbLanes = 16 * Channels;
+            type_t maximums[NbLanes] = { type_t(0) };
+
+            for (unsigned int y = startRow; y < endRow; ++y)
+            {
+                const type_t* data = bitmap->data(y);
+
+                if (step > 1)
+                {
+                    unsigned int i = 0;
+                    for (; i + NbLanes <= rowSize; i += NbLanes)
+                    {
+                        const type_t* values = data + i;
+
+                        for (unsigned int j = 0; j < NbLanes; ++j)
+                            maximums[j] = (values[j] > maximums[j] ? values[j] : maximums[j]);
+                    }
+
+                    for (; i < rowSize; ++i)
+                        maximums[i % Channels] = std::max(maximums[i % Channels], data[i]);
+
+                    if (y % step != 0)
+                        continue;
+                }
+
+                for (unsigned int i = 0; i < rowSize; i += step * Channels)
+                {
+                    for (unsigned int c = 0; c < Channels; ++c)
+                        ++histogram[c * NbBins + bin(data[i + c])];
+                }
+            }
+
+            for (unsigned int c = 0; c < Channels; ++c)
+            {
+                maxValues[index][c] = maximums[c];
+                for (unsigned int j = c + Channels; j < NbLanes; j += Channels)
+                    maxValues[index][c] = std::max(maxValues[index][c], maximums[j]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < nbWorkers; ++i)
+            threads.emplace_back(worker, i);
+
+        worker(0);
+
+        for (auto& thread : threads)
+            thread.join();
+
+        // Merge the histograms of the workers
+        for (unsigned int c = 0; c < Channels; ++c)
+        {
+            histograms[c].resize(NbBins);
+            std::fill(histograms[c].begin(), histograms[c].end(), 0);
+
+            type_t maximum = type_t(0);
+
+            for (unsigned int i = 0; i < nbWorkers; ++i)
+            {
+                const uint32_t* histogram = counts[i].data() + c * NbBins;
+
+                for (size_t j = 0; j < NbBins; ++j)
+                    histograms[c][j] += histogram[j];
+
+                maximum = std::max(maximum, maxValues[i][c]);
+            }
+
+            // Without subsampling, the maximum value falls into the last non-empty bin
+            // (the bins are monotonic)
+            if (subsampling > 1)
+            {
+                maxBins[c] = bin(maximum);
+            }
+            else
+            {
+                maxBins[c] = NbBins - 1;
+                while ((maxBins[c] > 0) && (histograms[c][maxBins[c]] == 0))
+                    --maxBins[c];
+            }
+        }
+    };
+
+    // For integer types and the usual ranges, the bins computed by 'computeHistogram()'
+    // (with a division) are obtained with integer operations
+    const auto divide = [maxValue](type_t v) { return uint16_t(double(v) / maxValue * 65535.0); };
+
+    if constexpr (std::is_integral_v<type_t>)
+    {
+        if (uint64_t(maxValue) == 65535)
+            process([](type_t v) { return uint16_t(v); });
+        else if (uint64_t(maxValue) == 255)
+            process([](type_t v) { return uint16_t((uint32_t(v) << 8) | uint32_t(v)); });
+        else if (uint64_t(maxValue) == 0xFFFFFFFF)
+            process([](type_t v) { return uint16_t(uint32_t(v) / 65537); });
+        else
+            process(divide);
+    }
+    else
+    {
+        process(divide);
+    }
+
+    return size_t((height + subsampling - 1) / subsampling) *
+           size_t((width + subsampling - 1) / subsampling);
+}
+
 }
 }
 }
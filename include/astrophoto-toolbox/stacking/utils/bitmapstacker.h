@@ -9,9 +9,14 @@
 #pragma once
 
 #include <astrophoto-toolbox/images/bitmap.h>
+#include <astrophoto-toolbox/data/rect.h>
+#include <astrophoto-toolbox/stacking/utils/cubefile.h>
 #include <filesystem>
 #include <vector>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 
 namespace astrophototoolbox {
@@ -19,12 +24,35 @@ namespace stacking {
 namespace utils {
 
     //------------------------------------------------------------------------------------
-    /// @brief  Allows to stack bitmaps, using the 'median' method
+    /// @brief  The different methods available to combine the stacked pixels
+    //------------------------------------------------------------------------------------
+    enum stacking_method_t
+    {
+        METHOD_MEDIAN,              ///< Median of the values
+        METHOD_AVERAGE,             ///< Average of the values
+        METHOD_WEIGHTED_AVERAGE,    ///< Average of the values, using per-bitmap weights
+        METHOD_KAPPA_SIGMA,         ///< Average after iterative kappa-sigma clipping
+        METHOD_WINSORIZED_SIGMA,    ///< Average after winsorized sigma clipping
+    };
+
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Allows to stack bitmaps, using one of several methods (by default:
+    ///         'median')
     ///
-    /// The median value of the pixels in the stack is computed for each pixel.
+    /// For each pixel, the values in the stack are combined using the selected method.
+    /// Pixels with a value of 0 (outside of the transformed frames) are ignored.
     ///
-    /// Internally, this class use several temporary files to reduce the memory load
-    /// during computation.
+    /// The (weighted) averages are accumulated on the fly in running means (8 bytes per
+    /// value), if those fit in the memory budget. Otherwise, and for the methods
+    /// requiring all the values of a pixel at once (median, kappa-sigma and winsorized
+    /// sigma), the bitmaps are kept in memory if they fit in the memory budget. If they
+    /// don't, they are stored in a temporary file (preallocated for the expected number
+    /// of bitmaps), which is then mapped in memory and processed by bands of rows sized
+    /// from the memory budget.
+    ///
+    /// The rows are combined in parallel, using several worker threads (by default, as
+    /// many as the hardware supports).
     ///
     /// This class is a reimplementation of the relevant parts of DeepSkyStacker's
     /// 'CMultiBitmap' class, adapted to astrophoto-toolbox needs.
@@ -39,10 +67,29 @@ namespace utils {
     public:
         //--------------------------------------------------------------------------------
         /// @brief  Setup the stacker
+        ///
+        /// 'memoryBudget' is the maximum amount of memory (in bytes) used to hold the
+        /// values of the bitmaps. If the expected number of bitmaps doesn't fit, a
+        /// temporary file is used (in 'tempFolder'). This is also the case if more bitmaps
+        /// than expected are added and the budget is exceeded.
+        ///
+        /// When a temporary file is used, 'maxFileSize' is the maximum size (in bytes) of
+        /// the values of all the bitmaps read from it at once.
         //--------------------------------------------------------------------------------
         void setup(
             unsigned int nbBitmaps, const std::filesystem::path& tempFolder = "",
-            unsigned long maxFileSize = 50000000L
+            unsigned long maxFileSize = 50000000L, unsigned long memoryBudget = 1000000000L
+        );
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Select the method used to combine the pixels
+        ///
+        /// 'kappa' and 'nbIterations' are only used by the sigma clipping methods.
+        ///
+        /// Note: must be called before adding any bitmap.
+        //--------------------------------------------------------------------------------
+        void setMethod(
+            stacking_method_t method, double kappa = 2.0, unsigned int nbIterations = 5
         );
 
         //--------------------------------------------------------------------------------
@@ -50,9 +97,50 @@ namespace utils {
         ///
         /// It is expected that all the bitmaps have the same dimensions and range.
         ///
+        /// The weight is only used by the 'weighted average' method.
+        ///
+        /// Note: 'setup()' must have been called before this method.
+        //--------------------------------------------------------------------------------
+        bool addBitmap(BITMAP* bitmap, double weight = 1.0);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Add a bitmap to the list of bitmaps to be stacked, produced band by
+        ///         band
+        ///
+        /// 'producer' is called with the signature:
+        ///
+        ///     void(const rect_t& area, BITMAP::type_t* rows)
+        ///
+        /// and must write the pixels of the area of the bitmap (without padding between
+        /// the rows) into 'rows'. When possible, 'rows' directly points to the storage of
+        /// the stacker, so no intermediate bitmap is needed.
+        ///
+        /// Only the pixels inside 'validRect' are requested and stored, the other ones are
+        /// considered as missing (like the pixels with a value of 0).
+        ///
+        /// It is expected that all the bitmaps have the same dimensions and range.
+        ///
+        /// The weight is only used by the 'weighted average' method.
+        ///
         /// Note: 'setup()' must have been called before this method.
         //--------------------------------------------------------------------------------
-        bool addBitmap(BITMAP* bitmap);
+        template<typename PRODUCER>
+        bool addBitmap(
+            unsigned int width, unsigned int height, range_t range,
+            const rect_t& validRect, PRODUCER producer, double weight = 1.0
+        );
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Add a bitmap to the list of bitmaps to be stacked, produced band by
+        ///         band
+        ///
+        /// Same as above, with all the pixels of the bitmap being valid.
+        //--------------------------------------------------------------------------------
+        template<typename PRODUCER>
+        bool addBitmap(
+            unsigned int width, unsigned int height, range_t range, PRODUCER producer,
+            double weight = 1.0
+        );
 
         //--------------------------------------------------------------------------------
         /// @brief  Performs the stacking of all the images that were added
@@ -60,7 +148,18 @@ namespace utils {
         BITMAP* process() const;
 
         //--------------------------------------------------------------------------------
-        /// @brief  Delete all the temporary files
+        /// @brief  Performs the stacking of an area of all the images that were added
+        ///
+        /// The returned bitmap has the dimensions of the area: nothing is computed (or
+        /// read from the temporary file) outside of it.
+        ///
+        /// Several areas can be processed at the same time from different threads (but
+        /// no bitmap must be added meanwhile).
+        //--------------------------------------------------------------------------------
+        BITMAP* process(const rect_t& area) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Delete the temporary file
         ///
         /// After this, the stacker object can be reused with an unrelated set of bitmaps.
         ///
@@ -96,51 +195,200 @@ namespace utils {
             cancelled = true;
         }
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Enable or disable the pixel-major layout during the combination
+        ///
+        /// When enabled, the values of each band are transposed (by tiles fitting in the
+        /// cache) so that the values of a pixel are contiguous in memory, instead of
+        /// being gathered from all the bitmaps for each pixel. This is faster with a lot
+        /// of bitmaps.
+        //--------------------------------------------------------------------------------
+        inline void setPixelMajorLayout(bool enabled)
+        {
+            pixelMajor = enabled;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Set the number of bands loaded in advance (from the temporary file),
+        ///         while the current one is combined
+        ///
+        /// Allows to overlap the disk accesses with the computations. The default is 1
+        /// (double buffering), 0 disables the asynchronous loading. The size of the bands
+        /// is reduced accordingly, to stay in the memory budget.
+        ///
+        /// Only used when the values of the bitmaps don't fit in memory.
+        //--------------------------------------------------------------------------------
+        inline void setNbPrefetchedBands(unsigned int nbBands)
+        {
+            nbPrefetchedBands = nbBands;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Set the number of worker threads used to combine the rows
+        ///
+        /// 0 means 'as many as the hardware supports' (the default).
+        //--------------------------------------------------------------------------------
+        inline void setNbThreads(unsigned int nbThreads)
+        {
+            this->nbThreads = nbThreads;
+        }
+
 
     private:
         //--------------------------------------------------------------------------------
-        /// @brief  Determine how the rows of all the images must be split in different
-        ///         temporary files
+        /// @brief  A row of a bitmap, containing the pixels [from, to) of the output row
         //--------------------------------------------------------------------------------
-        void initPartFiles();
+        struct source_t {
+            const typename BITMAP::type_t* row;
+            unsigned int from;
+            unsigned int to;
+            double weight;
+        };
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Scratch buffers used by a worker thread to combine rows
+        //--------------------------------------------------------------------------------
+        struct scratch_t {
+            std::vector<source_t> sources;
+            std::vector<typename BITMAP::type_t> values[BITMAP::Channels];
+            std::vector<typename BITMAP::type_t> tile;
+            std::vector<double> sums;
+            std::vector<double> totals;
+        };
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Size (in bytes) of the tiles used in pixel-major layout
+        //--------------------------------------------------------------------------------
+        static constexpr size_t TileSize = 32 * 1024;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Size (in bytes) of the buffer used to receive the bands of rows of the
+        ///         added bitmaps, when they can't be written directly in memory
+        //--------------------------------------------------------------------------------
+        static constexpr size_t IngestBufferSize = 4 * 1024 * 1024;
+
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates if the selected method is one of the averages (which don't
+        ///         require all the values of a pixel at once)
+        //--------------------------------------------------------------------------------
+        inline bool isAverage() const
+        {
+            return (method == METHOD_AVERAGE) || (method == METHOD_WEIGHTED_AVERAGE);
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Add the values of an area of a bitmap to the running means
+        //--------------------------------------------------------------------------------
+        void accumulate(
+            const rect_t& area, const typename BITMAP::type_t* rows, double weight
+        );
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Performs the stacking of an area using the running means
+        //--------------------------------------------------------------------------------
+        BITMAP* processAccumulated(const rect_t& area) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Create the temporary file
+        //--------------------------------------------------------------------------------
+        bool createFile();
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Increase the number of bitmaps that can be stored
+        ///
+        /// The values are moved to a temporary file if they don't fit in the memory
+        /// budget anymore.
+        //--------------------------------------------------------------------------------
+        bool grow();
 
         //--------------------------------------------------------------------------------
-        /// @brief  Stack the rows located in the provided buffer
+        /// @brief  Stack the rows of a band, from the provided bitmaps data
+        ///
+        /// The rows are distributed between the worker threads.
         //--------------------------------------------------------------------------------
         void stack(
-            unsigned int startRow, unsigned int endRow, unsigned int nbRowElements,
-            typename BITMAP::type_t* buffer, BITMAP* output
+            unsigned int startRow, unsigned int endRow, const rect_t& area,
+            const typename BITMAP::type_t* data, BITMAP* output,
+            std::vector<scratch_t>& scratches
         ) const;
 
         //--------------------------------------------------------------------------------
-        /// @brief  Stack one row by combining the provided row pointers (using the
-        ///         'median' method)
+        /// @brief  Stack one row of the output by combining the provided rows
         //--------------------------------------------------------------------------------
         void combine(
-            unsigned int row, const std::vector<typename BITMAP::type_t*>& srcRows,
-            BITMAP* output
+            unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+            scratch_t& scratch
         ) const requires(BITMAP::Channels == 3);
 
         //--------------------------------------------------------------------------------
-        /// @brief  Stack one row by combining the provided row pointers (using the
-        ///         'median' method)
+        /// @brief  Stack one row of the output by combining the provided rows
         //--------------------------------------------------------------------------------
         void combine(
-            unsigned int row, const std::vector<typename BITMAP::type_t*>& srcRows,
-            BITMAP* output
+            unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+            scratch_t& scratch
         ) const requires(BITMAP::Channels == 1);
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Stack one row of the output by transposing the values of the provided
+        ///         rows (by tiles), and combining the contiguous values of each pixel
+        //--------------------------------------------------------------------------------
+        void combineTransposed(
+            unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+            scratch_t& scratch
+        ) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Stack one row of the output by computing the (weighted) average of the
+        ///         provided rows
+        //--------------------------------------------------------------------------------
+        void combineAverage(
+            unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+            scratch_t& scratch
+        ) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Combine the values of one pixel (of one channel) using the selected
+        ///         method
+        ///
+        /// The order of the values is modified.
+        //--------------------------------------------------------------------------------
+        typename BITMAP::type_t combineValues(
+            typename BITMAP::type_t* values, size_t count
+        ) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Convert a computed value to the type of the bitmap
+        //--------------------------------------------------------------------------------
+        static typename BITMAP::type_t toValue(double value);
+
 
     private:
         //--------------------------------------------------------------------------------
-        /// @brief  Infos about a given temporary file
+        /// @brief  Infos about a given band of rows
         //--------------------------------------------------------------------------------
-        struct part_file_t {
-            std::filesystem::path filename;
+        struct band_t {
             unsigned int startRow;
             unsigned int endRow;
         };
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Infos about a stored bitmap: only the pixels of its valid rectangle
+        ///         are stored, starting at the given offset (in bytes)
+        //--------------------------------------------------------------------------------
+        struct frame_t {
+            rect_t rect;
+            size_t offset;
+            double weight;
+        };
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Determine how the rows of an area of all the images must be split in
+        ///         different bands
+        //--------------------------------------------------------------------------------
+        std::vector<band_t> computeBands(const rect_t& area) const;
+
 
     private:
         unsigned int nbBitmaps = 0;
@@ -149,10 +397,27 @@ namespace utils {
         unsigned int height = 0;
         range_t range = RANGE_ONE;
         unsigned long maxFileSize = 0;
+        unsigned long memoryBudget = 0;
+
+        stacking_method_t method = METHOD_MEDIAN;
+        double kappa = 2.0;
+        unsigned int nbIterations = 5;
 
         std::filesystem::path tempFolder;
-        std::vector<part_file_t> partFiles;
-        bool cancelled = false;
+        std::vector<typename BITMAP::type_t> memory;
+        bool inMemory = false;
+        CubeFile cube;
+        size_t frameSize = 0;
+        unsigned int capacity = 0;
+        std::vector<frame_t> frames;
+        size_t usedSize = 0;
+        bool accumulated = false;
+        std::vector<float> means;
+        std::vector<float> weights;
+        unsigned int nbThreads = 0;
+        unsigned int nbPrefetchedBands = 1;
+        bool pixelMajor = false;
+        std::atomic<bool> cancelled = false;
     };
 
 }
@@ -16,7 +16,8 @@
 #pragma once
 
 #include <astrophoto-toolbox/algorithms/math.h>
-#include <sstream>
+#include <thread>
+#include <cstring>
 
 namespace astrophototoolbox {
 namespace stacking {
@@ -34,7 +35,7 @@ BitmapStacker<BITMAP>::~BitmapStacker()
 template<class BITMAP>
 void BitmapStacker<BITMAP>::setup(
     unsigned int nbBitmaps, const std::filesystem::path& tempFolder,
-    unsigned long maxFileSize
+    unsigned long maxFileSize, unsigned long memoryBudget
 )
 {
     clear();
@@ -44,37 +45,160 @@ void BitmapStacker<BITMAP>::setup(
     this->width = 0;
     this->height = 0;
     this->maxFileSize = maxFileSize;
+    this->memoryBudget = memoryBudget;
     this->tempFolder = tempFolder;
+    this->cancelled = false;
 }
 
 //-----------------------------------------------------------------------------
 
 template<class BITMAP>
-bool BitmapStacker<BITMAP>::addBitmap(BITMAP* bitmap)
+void BitmapStacker<BITMAP>::setMethod(
+    stacking_method_t method, double kappa, unsigned int nbIterations
+)
+{
+    this->method = method;
+    this->kappa = kappa;
+    this->nbIterations = nbIterations;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+bool BitmapStacker<BITMAP>::addBitmap(BITMAP* bitmap, double weight)
 {
-    if (partFiles.empty())
+    const size_t pixelSize = BITMAP::Channels * BITMAP::ChannelSize;
+
+    return addBitmap(
+        bitmap->width(), bitmap->height(), bitmap->range(),
+        [bitmap, pixelSize](const rect_t& area, typename BITMAP::type_t* rows)
+        {
+            const size_t rowSize = area.width() * pixelSize;
+
+            for (int y = area.top; y < area.bottom; ++y)
+            {
+                memcpy(
+                    ((uint8_t*) rows) + (y - area.top) * rowSize,
+                    bitmap->data(area.left, y), rowSize
+                );
+            }
+        },
+        weight
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+template<typename PRODUCER>
+bool BitmapStacker<BITMAP>::addBitmap(
+    unsigned int width, unsigned int height, range_t range, PRODUCER producer,
+    double weight
+)
+{
+    return addBitmap(width, height, range, rect_t(0, 0, width, height), producer, weight);
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+template<typename PRODUCER>
+bool BitmapStacker<BITMAP>::addBitmap(
+    unsigned int width, unsigned int height, range_t range, const rect_t& validRect,
+    PRODUCER producer, double weight
+)
+{
+    const size_t pixelSize = BITMAP::Channels * BITMAP::ChannelSize;
+    const double bitmapWeight = (method == METHOD_WEIGHTED_AVERAGE ? weight : 1.0);
+
+    if (nbAddedBitmaps == 0)
     {
-        width = bitmap->width();
-        height = bitmap->height();
-        range = bitmap->range();
-        initPartFiles();
+        this->width = width;
+        this->height = height;
+        this->range = range;
+
+        // The averages only need the running means, if they fit in the budget
+        const size_t nbElements = size_t(width) * height * BITMAP::Channels;
+        accumulated = isAverage() && (nbElements * 2 * sizeof(float) <= memoryBudget);
+
+        if (accumulated)
+        {
+            means.assign(nbElements, 0.0f);
+            weights.assign(nbElements, 0.0f);
+        }
+        else
+        {
+            // Preallocate the space needed by the expected number of bitmaps, in memory
+            // if it fits in the budget
+            frameSize = pixelSize * width * height;
+            capacity = std::max(nbBitmaps, 1u);
+            inMemory = (capacity * frameSize <= memoryBudget);
+
+            if (inMemory)
+                memory.resize(capacity * frameSize / BITMAP::ChannelSize);
+            else if (!createFile())
+                return false;
+        }
     }
 
-    const size_t rowSize = bitmap->bytesPerRow();
+    rect_t rect = validRect.intersection(rect_t(0, 0, width, height));
+    if ((rect.width() <= 0) || (rect.height() <= 0))
+        rect = rect_t();
 
-    for (const auto& part : partFiles)
+    const size_t rowSize = rect.width() * pixelSize;
+    const size_t offset = usedSize;
+
+    if (!accumulated && (usedSize + rowSize * rect.height() > capacity * frameSize) &&
+        !grow())
     {
-        FILE* f = std::fopen(part.filename.string().c_str(), "ab");
-        if (!f)
-            return false;
+        return false;
+    }
 
-        for (int y = part.startRow; y <= part.endRow; ++y)
+    // Only the pixels of the valid rectangle are stored, one bitmap after the other,
+    // without padding between the rows. In memory, they are directly produced at their
+    // final location.
+    if (!accumulated)
+    {
+        frames.push_back(frame_t{ rect, offset, bitmapWeight });
+        usedSize += rowSize * rect.height();
+
+        if (inMemory)
         {
-            if (fwrite(bitmap->data(y), rowSize, 1, f) != 1)
-                return false;
+            if (rowSize > 0)
+                producer(rect, memory.data() + offset / BITMAP::ChannelSize);
+
+            ++nbAddedBitmaps;
+            return true;
         }
+    }
+
+    // Otherwise, they are produced by bands in a temporary buffer
+    if (rowSize > 0)
+    {
+        const int nbBandRows = std::clamp(
+            IngestBufferSize / rowSize, size_t(1), size_t(rect.height())
+        );
 
-        fclose(f);
+        std::vector<typename BITMAP::type_t> buffer(nbBandRows * rowSize / BITMAP::ChannelSize);
+
+        for (int startRow = rect.top; startRow < rect.bottom; startRow += nbBandRows)
+        {
+            const rect_t band(
+                rect.left, startRow, rect.right, std::min(startRow + nbBandRows, rect.bottom)
+            );
+
+            producer(band, buffer.data());
+
+            if (accumulated)
+            {
+                accumulate(band, buffer.data(), bitmapWeight);
+            }
+            else if (!cube.write(buffer.data(), band.height() * rowSize,
+                                 offset + (startRow - rect.top) * rowSize))
+            {
+                return false;
+            }
+        }
     }
 
     ++nbAddedBitmaps;
@@ -87,38 +211,153 @@ bool BitmapStacker<BITMAP>::addBitmap(BITMAP* bitmap)
 template<class BITMAP>
 BITMAP* BitmapStacker<BITMAP>::process() const
 {
-    bool cancelled = false;
+    return process(rect_t(0, 0, width, height));
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+BITMAP* BitmapStacker<BITMAP>::process(const rect_t& area) const
+{
+    const rect_t rect = area.intersection(rect_t(0, 0, width, height));
+    if ((rect.width() <= 0) || (rect.height() <= 0))
+        return nullptr;
+
+    if (accumulated)
+        return processAccumulated(rect);
+
+    const typename BITMAP::type_t* data = (
+        inMemory ? memory.data() : (const typename BITMAP::type_t*) cube.map()
+    );
+
+    if (!data)
+        return nullptr;
 
-    BITMAP* output = new BITMAP(width, height, range);
+    BITMAP* output = new BITMAP(rect.width(), rect.height(), range);
 
-    const unsigned int nbRowElements = width * BITMAP::Channels;
-    std::vector<typename BITMAP::type_t> buffer;
+    const size_t pixelSize = BITMAP::Channels * BITMAP::ChannelSize;
 
-    for (const auto& part : partFiles)
+    // One set of scratch buffers per worker thread, reused for all the bands
+    unsigned int nbWorkers = (nbThreads != 0 ? nbThreads : std::thread::hardware_concurrency());
+    nbWorkers = std::max(std::min(nbWorkers, (unsigned int) rect.height()), 1u);
+
+    std::vector<scratch_t> scratches(nbWorkers);
+    for (auto& scratch : scratches)
     {
-        const size_t bufferSize = nbRowElements * nbAddedBitmaps * (part.endRow - part.startRow + 1);
-        if (bufferSize > buffer.size())
-            buffer.resize(bufferSize);
+        scratch.sources.reserve(nbAddedBitmaps);
+
+        for (auto& values : scratch.values)
+            values.reserve(nbAddedBitmaps);
+    }
+
+    // Process the bands one by one, to limit the amount of memory needed
+    const std::vector<band_t> bands = computeBands(rect);
 
-        FILE* f = std::fopen(part.filename.string().c_str(), "rb");
-        if (!f)
+    // Call 'func(offset, size)' for the stored rows of each bitmap in the band
+    auto forEachFrame = [&](const band_t& band, auto func)
+    {
+        for (const frame_t& frame : frames)
         {
-            delete output;
-            return nullptr;
+            const int startRow = std::max((int) band.startRow, frame.rect.top);
+            const int endRow = std::min((int) band.endRow + 1, frame.rect.bottom);
+
+            if (startRow < endRow)
+            {
+                const size_t rowSize = frame.rect.width() * pixelSize;
+                func(frame.offset + (startRow - frame.rect.top) * rowSize, (endRow - startRow) * rowSize);
+            }
         }
+    };
 
-        size_t nb = fread(buffer.data(), BITMAP::ChannelSize, bufferSize, f);
-        fclose(f);
+    // Load the next bands in a background thread while the current one is combined
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchCondition;
+    size_t nbLoadedBands = 0;
+    size_t currentBand = 0;
+    bool stopPrefetching = false;
 
-        stack(part.startRow, part.endRow, nbRowElements, buffer.data(), output);
+    std::thread prefetcher;
+
+    if (!inMemory && (nbPrefetchedBands > 0))
+    {
+        prefetcher = std::thread([&]()
+        {
+            for (size_t i = 0; i < bands.size(); ++i)
+            {
+                {
+                    std::unique_lock lock(prefetchMutex);
+                    prefetchCondition.wait(lock, [&]{
+                        return stopPrefetching || (i <= currentBand + nbPrefetchedBands);
+                    });
+
+                    if (stopPrefetching)
+                        return;
+                }
+
+                forEachFrame(bands[i], [this](size_t offset, size_t size) { cube.load(offset, size); });
+
+                {
+                    std::lock_guard lock(prefetchMutex);
+                    nbLoadedBands = i + 1;
+                }
+
+                prefetchCondition.notify_all();
+            }
+        });
+    }
+
+    auto stopPrefetcher = [&]()
+    {
+        if (prefetcher.joinable())
+        {
+            {
+                std::lock_guard lock(prefetchMutex);
+                stopPrefetching = true;
+            }
+
+            prefetchCondition.notify_all();
+            prefetcher.join();
+        }
+    };
+
+    for (size_t i = 0; i < bands.size(); ++i)
+    {
+        const band_t& band = bands[i];
+
+        if (prefetcher.joinable())
+        {
+            std::unique_lock lock(prefetchMutex);
+            currentBand = i;
+            prefetchCondition.notify_all();
+            prefetchCondition.wait(lock, [&]{ return nbLoadedBands > i; });
+        }
+        else if (!inMemory)
+        {
+            forEachFrame(band, [this](size_t offset, size_t size) { cube.prefetch(offset, size); });
+        }
+
+        stack(band.startRow, band.endRow, rect, data, output, scratches);
+
+        if (!inMemory)
+            forEachFrame(band, [this](size_t offset, size_t size) { cube.release(offset, size); });
 
         if (cancelled)
         {
+            stopPrefetcher();
+
+            if (!inMemory)
+                cube.unmap();
+
             delete output;
             return nullptr;
         }
     }
 
+    stopPrefetcher();
+
+    if (!inMemory)
+        cube.unmap();
+
     return output;
 }
 
@@ -127,115 +366,253 @@ BITMAP* BitmapStacker<BITMAP>::process() const
 template<class BITMAP>
 void BitmapStacker<BITMAP>::clear()
 {
-    for (const auto& part : partFiles)
-        std::filesystem::remove(part.filename);
+    cube.close();
 
-    partFiles.clear();
+    memory.clear();
+    memory.shrink_to_fit();
+    inMemory = false;
+
+    frames.clear();
+    usedSize = 0;
     nbAddedBitmaps = 0;
+
+    accumulated = false;
+    means.clear();
+    means.shrink_to_fit();
+    weights.clear();
+    weights.shrink_to_fit();
 }
 
 //-----------------------------------------------------------------------------
 
 template<class BITMAP>
-void BitmapStacker<BITMAP>::initPartFiles()
+void BitmapStacker<BITMAP>::accumulate(
+    const rect_t& area, const typename BITMAP::type_t* rows, double weight
+)
 {
-    // Make files of maximum 50MB
-    const int lineSize = BITMAP::Channels * BITMAP::ChannelSize * width;
+    if (weight <= 0.0)
+        return;
 
-    const int nbLinesPerFile = maxFileSize / lineSize;
-    int nbLines = nbLinesPerFile / nbBitmaps;
-    int nbRemainingLines = nbLinesPerFile % nbBitmaps;
+    const size_t nbElements = size_t(area.width()) * BITMAP::Channels;
 
-    if (nbLines == 0)
-        nbLines = 1;
+    for (int y = area.top; y < area.bottom; ++y, rows += nbElements)
+    {
+        const size_t offset = (size_t(y) * width + area.left) * BITMAP::Channels;
 
-    partFiles.clear();
+        float* mean = means.data() + offset;
+        float* w = weights.data() + offset;
 
-    std::filesystem::create_directories(tempFolder);
+        // Running means instead of sums, to keep the precision of single-precision
+        // values whatever the number of bitmaps
+        for (size_t i = 0; i < nbElements; ++i)
+        {
+            if (rows[i])
+            {
+                const double total = w[i] + weight;
+                mean[i] = float(mean[i] + (rows[i] - mean[i]) * weight / total);
+                w[i] = float(total);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
 
-    unsigned int startRow = 0;
-    unsigned int endRow = 0;
+template<class BITMAP>
+BITMAP* BitmapStacker<BITMAP>::processAccumulated(const rect_t& area) const
+{
+    BITMAP* output = new BITMAP(area.width(), area.height(), range);
 
-    unsigned int part = 0;
-    while (endRow < height - 1)
+    const unsigned int nbRowElements = area.width() * BITMAP::Channels;
+
+    for (int y = area.top; y < area.bottom; ++y)
     {
-        endRow = startRow + nbLines - 1;
-        if (nbRemainingLines != 0)
+        const size_t offset = (size_t(y) * width + area.left) * BITMAP::Channels;
+        const float* mean = means.data() + offset;
+        const float* w = weights.data() + offset;
+        typename BITMAP::type_t* dest = output->data(y - area.top);
+
+        for (unsigned int i = 0; i < nbRowElements; ++i)
+            dest[i] = (w[i] > 0.0f ? toValue(mean[i]) : typename BITMAP::type_t(0));
+
+        if (cancelled)
         {
-            ++endRow;
-            --nbRemainingLines;
+            delete output;
+            return nullptr;
         }
+    }
+
+    return output;
+}
+
+//-----------------------------------------------------------------------------
 
-        endRow = std::min(endRow, height - 1);
+template<class BITMAP>
+bool BitmapStacker<BITMAP>::createFile()
+{
+    std::filesystem::create_directories(tempFolder);
+    return cube.create(tempFolder / "stack.dat", capacity * frameSize);
+}
+
+//-----------------------------------------------------------------------------
 
-        std::stringstream stream;
-        stream << "part" << std::setfill('0') << std::setw(4) << part << ".dat";
+template<class BITMAP>
+bool BitmapStacker<BITMAP>::grow()
+{
+    unsigned int newCapacity = capacity * 2;
 
-        partFiles.push_back(part_file_t{ tempFolder / stream.str(), startRow, endRow });
+    if (!inMemory)
+    {
+        capacity = newCapacity;
+        return cube.resize(capacity * frameSize);
+    }
 
-        startRow = endRow + 1;
-        ++part;
+    // Use the remaining memory budget first
+    newCapacity = std::min(newCapacity, (unsigned int) (memoryBudget / frameSize));
+    if (newCapacity > capacity)
+    {
+        capacity = newCapacity;
+        memory.resize(capacity * frameSize / BITMAP::ChannelSize);
+        return true;
     }
+
+    // Move the values in a file
+    capacity *= 2;
+
+    if (!createFile() || !cube.write(memory.data(), usedSize, 0))
+        return false;
+
+    memory.clear();
+    memory.shrink_to_fit();
+    inMemory = false;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+std::vector<typename BitmapStacker<BITMAP>::band_t> BitmapStacker<BITMAP>::computeBands(
+    const rect_t& area
+) const
+{
+    // All the values are already in memory: only one band needed
+    if (inMemory)
+        return { band_t{ (unsigned int) area.top, (unsigned int) area.bottom - 1 } };
+
+    // The bands must be small enough to keep the current one and the prefetched ones in
+    // the memory budget
+    const size_t bandSize = std::min(
+        size_t(maxFileSize), size_t(memoryBudget / (1 + nbPrefetchedBands))
+    );
+    const size_t lineSize = size_t(width) * BITMAP::Channels * BITMAP::ChannelSize * nbAddedBitmaps;
+    const unsigned int nbLines = std::max(bandSize / lineSize, size_t(1));
+
+    const unsigned int bottom = (unsigned int) area.bottom;
+
+    std::vector<band_t> bands;
+
+    for (unsigned int startRow = area.top; startRow < bottom; startRow += nbLines)
+        bands.push_back(band_t{ startRow, std::min(startRow + nbLines, bottom) - 1 });
+
+    return bands;
 }
 
 //-----------------------------------------------------------------------------
 
 template<class BITMAP>
 void BitmapStacker<BITMAP>::stack(
-    unsigned int startRow, unsigned int endRow, unsigned int nbRowElements,
-    typename BITMAP::type_t* buffer, BITMAP* output
+    unsigned int startRow, unsigned int endRow, const rect_t& area,
+    const typename BITMAP::type_t* data, BITMAP* output, std::vector<scratch_t>& scratches
 ) const
 {
     const int nbRows = endRow - startRow + 1;
 
-    std::vector<typename BITMAP::type_t*> srcRows(nbAddedBitmaps, nullptr);
+    // The rows are independent: each worker takes the next unprocessed one until none
+    // are left
+    std::atomic<unsigned int> nextRow = startRow;
 
-    for (unsigned int row = startRow; row <= endRow; ++row)
+    auto worker = [&](scratch_t& scratch)
     {
-        for (size_t k = 0, offset = (row - startRow) * nbRowElements; k < nbAddedBitmaps; ++k)
+        for (unsigned int row = nextRow++; row <= endRow; row = nextRow++)
         {
-            srcRows[k] = buffer + offset;
-            offset += nbRows * nbRowElements;
+            // Retrieve the part of the row stored for each bitmap (if any)
+            scratch.sources.clear();
+
+            for (const frame_t& frame : frames)
+            {
+                const rect_t& rect = frame.rect;
+
+                const int from = std::max(rect.left, area.left);
+                const int to = std::min(rect.right, area.right);
+
+                if ((int(row) < rect.top) || (int(row) >= rect.bottom) || (from >= to))
+                    continue;
+
+                const size_t offset = (
+                    size_t(row - rect.top) * rect.width() + (from - rect.left)
+                ) * BITMAP::Channels;
+
+                scratch.sources.push_back(source_t{
+                    data + frame.offset / BITMAP::ChannelSize + offset,
+                    (unsigned int) (from - area.left),
+                    (unsigned int) (to - area.left),
+                    frame.weight
+                });
+            }
+
+            if (isAverage())
+                combineAverage(row - area.top, scratch.sources, output, scratch);
+            else if (pixelMajor)
+                combineTransposed(row - area.top, scratch.sources, output, scratch);
+            else
+                combine(row - area.top, scratch.sources, output, scratch);
+
+            if (cancelled)
+                return;
         }
+    };
 
-        combine(row, srcRows, output);
+    const size_t nbWorkers = std::min(scratches.size(), size_t(nbRows));
 
-        if (cancelled)
-            return;
-    }
+    std::vector<std::thread> threads;
+    threads.reserve(nbWorkers - 1);
+
+    for (size_t i = 1; i < nbWorkers; ++i)
+        threads.emplace_back(worker, std::ref(scratches[i]));
+
+    worker(scratches[0]);
+
+    for (auto& thread : threads)
+        thread.join();
 }
 
 //-----------------------------------------------------------------------------
 
 template<class BITMAP>
 void BitmapStacker<BITMAP>::combine(
-    unsigned int row, const std::vector<typename BITMAP::type_t*>& srcRows,
-    BITMAP* output
+    unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+    scratch_t& scratch
 ) const requires(BITMAP::Channels == 3)
 {
-    const typename BITMAP::type_t maxValue = output->maxRangeValue();
-
-    std::vector<typename BITMAP::type_t> redValues;
-    std::vector<typename BITMAP::type_t> greenValues;
-    std::vector<typename BITMAP::type_t> blueValues;
-
-    redValues.reserve(srcRows.size());
-    greenValues.reserve(srcRows.size());
-    blueValues.reserve(srcRows.size());
+    std::vector<typename BITMAP::type_t>& redValues = scratch.values[0];
+    std::vector<typename BITMAP::type_t>& greenValues = scratch.values[1];
+    std::vector<typename BITMAP::type_t>& blueValues = scratch.values[2];
 
     typename BITMAP::type_t* dest = output->data(row);
 
-    sparse_histogram_t histogram;
-
     for (unsigned int i = 0; i < output->width(); ++i)
     {
         redValues.resize(0);
         greenValues.resize(0);
         blueValues.resize(0);
 
-        for (const typename BITMAP::type_t* ptr : srcRows)
+        for (const source_t& source : sources)
         {
-            const typename BITMAP::type_t* p = ptr + i * 3;
+            if ((i < source.from) || (i >= source.to))
+                continue;
+
+            const typename BITMAP::type_t* p = source.row + (i - source.from) * 3;
 
             if (p[0])
                 redValues.push_back(p[0]);
@@ -247,10 +624,9 @@ void BitmapStacker<BITMAP>::combine(
                 blueValues.push_back(p[2]);
         }
 
-        // Median method
-        dest[0] = computeMedian(redValues, histogram, maxValue);
-        dest[1] = computeMedian(greenValues, histogram, maxValue);
-        dest[2] = computeMedian(blueValues, histogram, maxValue);
+        dest[0] = combineValues(redValues.data(), redValues.size());
+        dest[1] = combineValues(greenValues.data(), greenValues.size());
+        dest[2] = combineValues(blueValues.data(), blueValues.size());
 
         dest += 3;
     }
@@ -260,39 +636,172 @@ void BitmapStacker<BITMAP>::combine(
 
 template<class BITMAP>
 void BitmapStacker<BITMAP>::combine(
-    unsigned int row, const std::vector<typename BITMAP::type_t*>& srcRows,
-    BITMAP* output
+    unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+    scratch_t& scratch
 ) const requires(BITMAP::Channels == 1)
 {
-    const typename BITMAP::type_t maxValue = output->maxRangeValue();
-
-    std::vector<typename BITMAP::type_t> values;
-
-    values.reserve(srcRows.size());
+    std::vector<typename BITMAP::type_t>& values = scratch.values[0];
 
     typename BITMAP::type_t* dest = output->data(row);
 
-    sparse_histogram_t histogram;
-
     for (unsigned int i = 0; i < output->width(); ++i)
     {
         values.resize(0);
 
-        for (const typename BITMAP::type_t* ptr : srcRows)
+        for (const source_t& source : sources)
         {
-            const typename BITMAP::type_t* p = ptr + i;
+            if ((i < source.from) || (i >= source.to))
+                continue;
+
+            const typename BITMAP::type_t* p = source.row + (i - source.from);
 
             if (*p)
                 values.push_back(*p);
         }
 
-        // Median method
-        *dest = computeMedian(values, histogram, maxValue);
+        *dest = combineValues(values.data(), values.size());
 
         ++dest;
     }
 }
 
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void BitmapStacker<BITMAP>::combineTransposed(
+    unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+    scratch_t& scratch
+) const
+{
+    const size_t nbRowElements = output->width() * BITMAP::Channels;
+    const size_t nbValues = sources.size();
+
+    // Number of row elements (pixels * channels) per tile
+    const size_t tileWidth = std::max(
+        TileSize / (std::max(nbValues, size_t(1)) * BITMAP::ChannelSize), size_t(1)
+    );
+
+    scratch.tile.resize(tileWidth * nbValues);
+    typename BITMAP::type_t* tile = scratch.tile.data();
+
+    typename BITMAP::type_t* dest = output->data(row);
+
+    for (size_t start = 0; start < nbRowElements; start += tileWidth)
+    {
+        const size_t count = std::min(tileWidth, nbRowElements - start);
+
+        // Transpose: the values of each row element are stored contiguously (with 0 for
+        // the elements not stored for a bitmap)
+        for (size_t k = 0; k < nbValues; ++k)
+        {
+            const source_t& source = sources[k];
+            const size_t from = std::clamp(size_t(source.from) * BITMAP::Channels, start, start + count);
+            const size_t to = std::clamp(size_t(source.to) * BITMAP::Channels, from, start + count);
+
+            typename BITMAP::type_t* dst = tile + k;
+            const typename BITMAP::type_t* src = source.row;
+            const size_t offset = size_t(source.from) * BITMAP::Channels;
+
+            for (size_t i = start; i < from; ++i)
+                dst[(i - start) * nbValues] = 0;
+
+            for (size_t i = from; i < to; ++i)
+                dst[(i - start) * nbValues] = src[i - offset];
+
+            for (size_t i = to; i < start + count; ++i)
+                dst[(i - start) * nbValues] = 0;
+        }
+
+        // Combine the values of each row element (ignoring the 0 ones)
+        for (size_t i = 0; i < count; ++i)
+        {
+            typename BITMAP::type_t* values = tile + i * nbValues;
+
+            size_t n = 0;
+            for (size_t k = 0; k < nbValues; ++k)
+            {
+                if (values[k])
+                    values[n++] = values[k];
+            }
+
+            dest[start + i] = combineValues(values, n);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void BitmapStacker<BITMAP>::combineAverage(
+    unsigned int row, const std::vector<source_t>& sources, BITMAP* output,
+    scratch_t& scratch
+) const
+{
+    const size_t nbRowElements = output->width() * BITMAP::Channels;
+
+    scratch.sums.assign(nbRowElements, 0.0);
+    scratch.totals.assign(nbRowElements, 0.0);
+
+    double* sums = scratch.sums.data();
+    double* totals = scratch.totals.data();
+
+    for (const source_t& source : sources)
+    {
+        const size_t from = size_t(source.from) * BITMAP::Channels;
+        const size_t to = size_t(source.to) * BITMAP::Channels;
+
+        for (size_t i = from; i < to; ++i)
+        {
+            const typename BITMAP::type_t value = source.row[i - from];
+
+            if (value)
+            {
+                sums[i] += source.weight * value;
+                totals[i] += source.weight;
+            }
+        }
+    }
+
+    typename BITMAP::type_t* dest = output->data(row);
+
+    for (size_t i = 0; i < nbRowElements; ++i)
+    {
+        dest[i] = (totals[i] > 0.0 ? toValue(sums[i] / totals[i])
+                                   : typename BITMAP::type_t(0));
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+typename BITMAP::type_t BitmapStacker<BITMAP>::combineValues(
+    typename BITMAP::type_t* values, size_t count
+) const
+{
+    switch (method)
+    {
+        case METHOD_KAPPA_SIGMA:
+            return toValue(computeKappaSigmaClippedAverage(values, count, kappa, nbIterations));
+
+        case METHOD_WINSORIZED_SIGMA:
+            return toValue(computeWinsorizedSigmaClippedAverage(values, count, kappa, nbIterations));
+
+        default:
+            return selectMedian(values, count);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+typename BITMAP::type_t BitmapStacker<BITMAP>::toValue(double value)
+{
+    if constexpr (std::is_integral_v<typename BITMAP::type_t>)
+        return typename BITMAP::type_t(value + 0.5);
+    else
+        return typename BITMAP::type_t(value);
+}
+
 }
 }
 }
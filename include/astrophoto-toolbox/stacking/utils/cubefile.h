@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <cstdint>
+#include <cstdio>
+
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Temporary file of a known size, written at specific offsets and read
+    ///         through a memory mapping
+    ///
+    /// Used to store the values of all the bitmaps to stack. The file is deleted when
+    /// closed.
+    //------------------------------------------------------------------------------------
+    class CubeFile
+    {
+    public:
+        ~CubeFile();
+
+
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Create the file, and preallocate it
+        //--------------------------------------------------------------------------------
+        bool create(const std::filesystem::path& filename, size_t size);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Change the size of the file (must not be mapped)
+        //--------------------------------------------------------------------------------
+        bool resize(size_t size);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Write some data at the given offset
+        //--------------------------------------------------------------------------------
+        bool write(const void* data, size_t size, size_t offset);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Map the content of the file in memory (read-only)
+        ///
+        /// The mapping is expected to be read sequentially. Returns nullptr in case of
+        /// error.
+        ///
+        /// The mapping is reference-counted, so several readers (possibly in different
+        /// threads) can use it at the same time: each successful call must be balanced by
+        /// a call to 'unmap()'.
+        //--------------------------------------------------------------------------------
+        const uint8_t* map() const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Release a reference to the mapping of the file, and remove the mapping
+        ///         once it isn't used anymore
+        //--------------------------------------------------------------------------------
+        void unmap() const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates that a part of the mapping will be read soon
+        //--------------------------------------------------------------------------------
+        void prefetch(size_t offset, size_t size) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Load a part of the mapping in memory (blocking call)
+        //--------------------------------------------------------------------------------
+        void load(size_t offset, size_t size) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates that a part of the mapping will not be read anymore
+        //--------------------------------------------------------------------------------
+        void release(size_t offset, size_t size) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Close and delete the file
+        //--------------------------------------------------------------------------------
+        void close();
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates if the file is opened
+        //--------------------------------------------------------------------------------
+        inline bool isOpened() const
+        {
+#ifdef _WIN32
+            return (file != nullptr);
+#else
+            return (fd != -1);
+#endif
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the size of the file
+        //--------------------------------------------------------------------------------
+        inline size_t size() const
+        {
+            return fileSize;
+        }
+
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  Remove the mapping of the file, whatever the number of references to
+        ///         it (the mutex must be locked)
+        //--------------------------------------------------------------------------------
+        void removeMapping() const;
+
+
+    private:
+        std::filesystem::path filename;
+        size_t fileSize = 0;
+
+        mutable std::mutex mappingMutex;
+        mutable unsigned int nbMappingReferences = 0;
+
+        mutable uint8_t* mapping = nullptr;
+
+#ifdef _WIN32
+        FILE* file = nullptr;
+        mutable void* mappingHandle = nullptr;
+#else
+        int fd = -1;
+#endif
+    };
+
+}
+}
+}
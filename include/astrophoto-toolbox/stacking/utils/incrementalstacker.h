@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <astrophoto-toolbox/images/bitmap.h>
+#include <astrophoto-toolbox/data/rect.h>
+#include <vector>
+
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  The different estimates computed by the incremental stacker
+    //------------------------------------------------------------------------------------
+    enum estimate_t
+    {
+        ESTIMATE_MEAN,      ///< Running mean of the values
+        ESTIMATE_MEDIAN,    ///< Approximation of the median of the values
+    };
+
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Allows to stack bitmaps incrementally, without keeping all the values
+    ///
+    /// For each pixel, the running mean of the values is updated each time a bitmap is
+    /// added, as well as an approximation of their median (using a stochastic
+    /// approximation, with a step size derived from an approximation of their median
+    /// absolute deviation) and their variance (using Welford's algorithm).
+    ///
+    /// The estimates are stored as single-precision values, so only 20 bytes per value
+    /// are needed.
+    ///
+    /// Adding a bitmap or retrieving the stacked one only costs O(pixels), whatever the
+    /// number of bitmaps already added. This is meant for live stacking: use
+    /// 'BitmapStacker' to compute the exact median.
+    ///
+    /// Pixels with a value of 0 (outside of the transformed frames) are ignored.
+    //------------------------------------------------------------------------------------
+    template<class BITMAP>
+    class IncrementalStacker
+    {
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Add a bitmap to the stack
+        ///
+        /// It is expected that all the bitmaps have the same dimensions and range.
+        //--------------------------------------------------------------------------------
+        void addBitmap(BITMAP* bitmap);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Start to add a bitmap to the stack band by band
+        ///
+        /// 'addRows()' must then be called for all the valid areas of the bitmap, followed
+        /// by 'endBitmap()'. This allows to feed the stacker without an intermediate bitmap.
+        ///
+        /// It is expected that all the bitmaps have the same dimensions and range.
+        //--------------------------------------------------------------------------------
+        void beginBitmap(unsigned int width, unsigned int height, range_t range);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Add the pixels of an area of the current bitmap (without padding
+        ///         between the rows)
+        ///
+        /// The pixels outside of the added areas are considered as missing.
+        //--------------------------------------------------------------------------------
+        void addRows(const rect_t& area, const typename BITMAP::type_t* rows);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates that all the rows of the current bitmap were added
+        //--------------------------------------------------------------------------------
+        void endBitmap();
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the stacked bitmap, using the provided estimate
+        //--------------------------------------------------------------------------------
+        BITMAP* process(estimate_t estimate = ESTIMATE_MEDIAN) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the standard deviation of the values of each pixel
+        //--------------------------------------------------------------------------------
+        BITMAP* processStandardDeviation() const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Forget all the bitmaps already added
+        //--------------------------------------------------------------------------------
+        void clear();
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of bitmaps stacked
+        //--------------------------------------------------------------------------------
+        inline unsigned int nbStackedBitmaps() const
+        {
+            return nbAddedBitmaps;
+        }
+
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  Update the estimates of consecutive elements with their new values
+        //--------------------------------------------------------------------------------
+        static void addElements(
+            const typename BITMAP::type_t* rows, size_t nbElements, uint32_t* count,
+            float* mean, float* squareDiff, float* median, float* deviation, double gain
+        );
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Convert a computed value to the type of the bitmap
+        //--------------------------------------------------------------------------------
+        static typename BITMAP::type_t toValue(double value);
+
+
+    private:
+        unsigned int nbAddedBitmaps = 0;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        range_t range = RANGE_ONE;
+
+        std::vector<uint32_t> counts;
+        std::vector<float> means;
+        std::vector<float> squareDiffs;
+        std::vector<float> medians;
+        std::vector<float> deviations;
+    };
+
+}
+}
+}
+
+
+#include <astrophoto-toolbox/stacking/utils/incrementalstacker.hpp>
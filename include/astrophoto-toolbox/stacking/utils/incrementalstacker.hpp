@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::addBitmap(BITMAP* bitmap)
+{
+    beginBitmap(bitmap->width(), bitmap->height(), bitmap->range());
+
+    for (unsigned int y = 0; y < height; ++y)
+        addRows(rect_t(0, y, width, y + 1), bitmap->data(y));
+
+    endBitmap();
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::beginBitmap(
+    unsigned int width, unsigned int height, range_t range
+)
+{
+    if (nbAddedBitmaps == 0)
+    {
+        this->width = width;
+        this->height = height;
+        this->range = range;
+
+        const size_t nbElements = size_t(width) * height * BITMAP::Channels;
+
+        counts.assign(nbElements, 0);
+        means.assign(nbElements, 0.0f);
+        squareDiffs.assign(nbElements, 0.0f);
+        medians.assign(nbElements, 0.0f);
+        deviations.assign(nbElements, 0.0f);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::addRows(
+    const rect_t& area, const typename BITMAP::type_t* rows
+)
+{
+    // Gain of the median approximation: optimal for normally distributed values
+    const double gain = sqrt(2.0 * M_PI);
+
+    const size_t nbElements = size_t(area.width()) * BITMAP::Channels;
+
+    for (int y = area.top; y < area.bottom; ++y, rows += nbElements)
+    {
+        const size_t offset = (size_t(y) * width + area.left) * BITMAP::Channels;
+
+        addElements(
+            rows, nbElements, counts.data() + offset, means.data() + offset,
+            squareDiffs.data() + offset, medians.data() + offset,
+            deviations.data() + offset, gain
+        );
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::addElements(
+    const typename BITMAP::type_t* rows, size_t nbElements, uint32_t* count,
+    float* mean, float* squareDiff, float* median, float* deviation, double gain
+)
+{
+    for (size_t i = 0; i < nbElements; ++i)
+    {
+        if (!rows[i])
+            continue;
+
+        const double v = rows[i];
+        const uint32_t n = ++count[i];
+
+        const double delta = v - mean[i];
+        const double newMean = mean[i] + delta / n;
+        mean[i] = float(newMean);
+
+        const double newSquareDiff = squareDiff[i] + delta * (v - newMean);
+        squareDiff[i] = float(newSquareDiff);
+
+        if (n == 1)
+        {
+            median[i] = float(v);
+            continue;
+        }
+
+        // The step size is derived from the (approximated) median absolute
+        // deviation, to be robust against outliers. The standard deviation is only
+        // used while the former isn't reliable yet, with a decreasing weight.
+        const double scale = std::max(1.4826 * deviation[i], sqrt(newSquareDiff / n) / n);
+        const double step = gain * scale / n;
+
+        const double newMedian = median[i] + std::clamp(v - median[i], -step, step);
+        median[i] = float(newMedian);
+        deviation[i] += float(std::clamp(fabs(v - newMedian) - deviation[i], -step, step));
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::endBitmap()
+{
+    ++nbAddedBitmaps;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+BITMAP* IncrementalStacker<BITMAP>::process(estimate_t estimate) const
+{
+    BITMAP* output = new BITMAP(width, height, range);
+
+    const unsigned int nbRowElements = width * BITMAP::Channels;
+    const std::vector<float>& values = (estimate == ESTIMATE_MEAN ? means : medians);
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const size_t offset = size_t(y) * nbRowElements;
+        const uint32_t* count = counts.data() + offset;
+        const float* src = values.data() + offset;
+        typename BITMAP::type_t* dest = output->data(y);
+
+        for (unsigned int i = 0; i < nbRowElements; ++i)
+            dest[i] = (count[i] > 0 ? toValue(src[i]) : typename BITMAP::type_t(0));
+    }
+
+    return output;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+BITMAP* IncrementalStacker<BITMAP>::processStandardDeviation() const
+{
+    BITMAP* output = new BITMAP(width, height, range);
+
+    const unsigned int nbRowElements = width * BITMAP::Channels;
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const size_t offset = size_t(y) * nbRowElements;
+        const uint32_t* count = counts.data() + offset;
+        const float* squareDiff = squareDiffs.data() + offset;
+        typename BITMAP::type_t* dest = output->data(y);
+
+        for (unsigned int i = 0; i < nbRowElements; ++i)
+        {
+            dest[i] = (count[i] > 0 ? toValue(sqrt(squareDiff[i] / count[i]))
+                                    : typename BITMAP::type_t(0));
+        }
+    }
+
+    return output;
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+void IncrementalStacker<BITMAP>::clear()
+{
+    nbAddedBitmaps = 0;
+
+    counts.clear();
+    counts.shrink_to_fit();
+    means.clear();
+    means.shrink_to_fit();
+    squareDiffs.clear();
+    squareDiffs.shrink_to_fit();
+    medians.clear();
+    medians.shrink_to_fit();
+    deviations.clear();
+    deviations.shrink_to_fit();
+}
+
+//-----------------------------------------------------------------------------
+
+template<class BITMAP>
+typename BITMAP::type_t IncrementalStacker<BITMAP>::toValue(double value)
+{
+    if constexpr (std::is_integral_v<typename BITMAP::type_t>)
+        return typename BITMAP::type_t(value + 0.5);
+    else
+        return typename BITMAP::type_t(value);
+}
+
+}
+}
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <astrophoto-toolbox/data/transformation.h>
+
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Predicts the transformation of the next frame of a sequence from the ones
+    ///         of the previous frames
+    ///
+    /// The drift between consecutive frames is assumed to be constant: the coefficients
+    /// of the last two accepted transformations are linearly extrapolated (with only one
+    /// accepted transformation, it is returned as-is).
+    ///
+    /// The prediction is meant to be given to 'StarMatcher::computeTransformation()',
+    /// which checks it.
+    //------------------------------------------------------------------------------------
+    class MotionPredictor
+    {
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Add the transformation accepted for the last frame
+        //--------------------------------------------------------------------------------
+        void add(const Transformation& transformation);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Predict the transformation of the next frame
+        ///
+        /// Returns false if no transformation was accepted yet.
+        //--------------------------------------------------------------------------------
+        bool predict(Transformation& prediction) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Forget all the accepted transformations
+        //--------------------------------------------------------------------------------
+        inline void clear()
+        {
+            nbTransformations = 0;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of accepted transformations
+        //--------------------------------------------------------------------------------
+        inline unsigned int size() const
+        {
+            return nbTransformations;
+        }
+
+    private:
+        Transformation last;
+        Transformation previous;
+        unsigned int nbTransformations = 0;
+    };
+
+}
+}
+}
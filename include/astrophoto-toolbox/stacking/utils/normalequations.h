@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <astrophoto-toolbox/data/point.h>
+#include <astrophoto-toolbox/data/transformation.h>
+
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Accumulates the normal equations of the least squares fit of a bilinear
+    ///         transformation between pairs of points. Used by the star matching
+    ///         algorithm.
+    ///
+    /// Adding or removing a pair only updates a fixed-size 4x4 matrix (and the right-hand
+    /// sides of both axes), so a transformation can be refined one pair at a time without
+    /// starting from scratch nor allocating memory.
+    ///
+    /// The coordinates are normalized using the dimensions of the image, like in
+    /// 'Transformation'.
+    //------------------------------------------------------------------------------------
+    class NormalEquations
+    {
+    public:
+        NormalEquations(double width, double height);
+
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Add a pair of points, the transformation mapping 'from' to 'to'
+        //--------------------------------------------------------------------------------
+        inline void add(const point_t& from, const point_t& to)
+        {
+            update(from, to, 1.0);
+            ++nbPairs;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Remove a pair of points previously added
+        //--------------------------------------------------------------------------------
+        inline void remove(const point_t& from, const point_t& to)
+        {
+            update(from, to, -1.0);
+            --nbPairs;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Remove all the pairs
+        //--------------------------------------------------------------------------------
+        void clear();
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of pairs
+        //--------------------------------------------------------------------------------
+        inline unsigned int size() const
+        {
+            return nbPairs;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Compute the transformation fitting the pairs best
+        ///
+        /// Returns false if the system can't be solved (not enough pairs, or degenerate
+        /// configuration of the points).
+        //--------------------------------------------------------------------------------
+        bool solve(Transformation& transformation) const;
+
+    private:
+        void update(const point_t& from, const point_t& to, double weight);
+
+    private:
+        double width;
+        double height;
+        unsigned int nbPairs = 0;
+
+        // Upper triangle of the 4x4 symmetric matrix (M^T * M), and right-hand sides
+        // (M^T * X and M^T * Y)
+        double normal[10] = { 0.0 };
+        double rhsX[4] = { 0.0 };
+        double rhsY[4] = { 0.0 };
+    };
+
+}
+}
+}
@@ -11,6 +11,7 @@
 #include <astrophoto-toolbox/images/bitmap.h>
 #include <astrophoto-toolbox/data/rect.h>
 #include <astrophoto-toolbox/data/star.h>
+#include <limits>
 
 
 namespace astrophototoolbox {
@@ -39,6 +40,10 @@ namespace utils {
         ///
         /// Note that to compare the overall quality of two lists of stars, the same
         /// threshold must have been used during registration.
+        ///
+        /// The detection is performed on the luminance of the bitmap, computed as a
+        /// single-precision bitmap (a FloatGrayBitmap with a RANGE_ONE range is used
+        /// as-is).
         //--------------------------------------------------------------------------------
         const star_list_t registerBitmap(Bitmap* bitmap, int luminancyThreshold = 10);
 
@@ -50,6 +55,92 @@ namespace utils {
             return luminancyThreshold;
         }
 
+        //--------------------------------------------------------------------------------
+        /// @brief  Set the number of worker threads used to process the rectangles of
+        ///         the bitmap
+        ///
+        /// 0 means 'as many as the hardware supports' (the default). The detected stars
+        /// don't depend on the number of threads.
+        //--------------------------------------------------------------------------------
+        inline void setNbThreads(unsigned int nbThreads)
+        {
+            this->nbThreads = nbThreads;
+        }
+
+
+    private:
+        //--------------------------------------------------------------------------------
+        /// @brief  A pixel of the bitmap that looks like the center of a star
+        ///
+        /// Contains everything needed to decide if the star must be kept, which doesn't
+        /// depend on the other stars.
+        //--------------------------------------------------------------------------------
+        struct candidate_t {
+            int x;
+            int y;
+            int deltaRadius;    ///< Smallest difference of radiuses accepted for the star
+            star_t star;        ///< The star, with its real position
+        };
+
+        typedef std::vector<candidate_t> candidate_list_t;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  A rectangular part of the bitmap, with its candidate stars
+        ///
+        /// Only the pixels with an intensity of at least 'minIntensity' were searched, so
+        /// the candidates can be reused for all the thresholds above that value.
+        //--------------------------------------------------------------------------------
+        struct tile_t {
+            rect_t rect;
+            candidate_list_t candidates;
+            double minIntensity = std::numeric_limits<double>::infinity();
+        };
+
+        typedef std::vector<tile_t> tile_list_t;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Spatial index of the detected stars
+        ///
+        /// The bitmap is divided in square cells of STARMAXSIZE pixels, each one
+        /// referencing the stars located in it (as a linked list of indices in the
+        /// list of stars), so the stars around a position are found in constant time.
+        //--------------------------------------------------------------------------------
+        struct star_grid_t {
+            //----------------------------------------------------------------------------
+            /// @brief  Clear the index and set the dimensions of the bitmap
+            //----------------------------------------------------------------------------
+            void setup(unsigned int width, unsigned int height);
+
+            //----------------------------------------------------------------------------
+            /// @brief  Add a star to the index
+            //----------------------------------------------------------------------------
+            void add(const star_t& star);
+
+            //----------------------------------------------------------------------------
+            /// @brief  Indicates if a pixel is contained in one of the stars
+            //----------------------------------------------------------------------------
+            bool contains(int x, int y) const;
+
+            //----------------------------------------------------------------------------
+            /// @brief  Indicates if a star overlaps one of the stars
+            //----------------------------------------------------------------------------
+            bool overlaps(const star_t& star, double radiusFactor) const;
+
+            //----------------------------------------------------------------------------
+            /// @brief  Indicates if 'predicate' is true for one of the stars located at
+            ///         less than 'distance' pixels (along each axis) of a position
+            //----------------------------------------------------------------------------
+            template<typename PREDICATE>
+            bool any(const point_t& position, double distance, PREDICATE predicate) const;
+
+            star_list_t stars;
+            std::vector<int32_t> heads;     ///< Index of the first star of each cell
+            std::vector<int32_t> next;      ///< Index of the next star in the same cell
+            int nbCellsX = 0;
+            int nbCellsY = 0;
+            double maxRadius = 0.0;
+        };
+
 
     private:
         //--------------------------------------------------------------------------------
@@ -57,7 +148,7 @@ namespace utils {
         ///         specified
         //--------------------------------------------------------------------------------
         void registerBitmapWithFixedThreshold(
-            DoubleGrayBitmap* luminance, double median, star_list_t& stars
+            FloatGrayBitmap* luminance, double median, star_list_t& stars
         );
 
         //--------------------------------------------------------------------------------
@@ -65,22 +156,54 @@ namespace utils {
         ///         the same time
         //--------------------------------------------------------------------------------
         void registerBitmapAndSearchThreshold(
-            DoubleGrayBitmap* luminance, double median, star_list_t& stars
+            FloatGrayBitmap* luminance, double median, star_list_t& stars
         );
 
         //--------------------------------------------------------------------------------
-        /// @brief  Detect the stars in a rectangular part of the bitmap
+        /// @brief  Detect the stars in all the rectangles of the bitmap
+        ///
+        /// The candidates of the rectangles are searched in parallel, and processed in
+        /// the order of the rectangles, so the result is the same than if everything was
+        /// done sequentially. Stops once more than 100 stars were found.
+        ///
+        /// The candidates are kept in 'tiles' (created if empty), and only searched again
+        /// for the pixels that weren't above the threshold of the previous calls.
+        ///
+        /// Returns the number of stars found.
+        //--------------------------------------------------------------------------------
+        int registerRects(
+            const FloatGrayBitmap* bitmap, double background, double minLuminancy,
+            tile_list_t& tiles, star_grid_t& stars
+        ) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Search the candidate stars in a rectangular part of the bitmap, among
+        ///         the pixels with an intensity in [minIntensity, maxIntensity)
+        ///
+        /// The candidates are appended to the list, which is kept sorted by roundness
+        /// (their 'deltaRadius'), then in the order of their pixels in the bitmap.
+        //--------------------------------------------------------------------------------
+        void detectCandidates(
+            const FloatGrayBitmap* bitmap, const rect_t& rect, double background,
+            double minIntensity, double maxIntensity, candidate_list_t& candidates
+        ) const;
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Add the candidate stars of a rectangular part of the bitmap that are
+        ///         above the threshold and don't overlap with the already found ones
+        ///
+        /// Returns the number of stars added.
         //--------------------------------------------------------------------------------
         int registerRect(
-            const DoubleGrayBitmap* bitmap, const rect_t& rect, double background,
-            double minLuminancy, star_set_t& stars
+            const candidate_list_t& candidates, double intensityThreshold,
+            star_grid_t& stars
         ) const;
 
         //--------------------------------------------------------------------------------
         /// @brief  Affine the coordinates of a detected star
         //--------------------------------------------------------------------------------
         bool computeStarCenter(
-            const DoubleGrayBitmap* bitmap, point_t& position, double& radius,
+            const FloatGrayBitmap* bitmap, point_t& position, double& radius,
             double background
         ) const;
 
@@ -90,6 +213,7 @@ namespace utils {
         static constexpr double ROUNDNESS_TOLERANCE = 2.0;
 
         int luminancyThreshold = 10;
+        unsigned int nbThreads = 0;
     };
 
 }
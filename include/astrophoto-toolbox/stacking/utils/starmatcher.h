@@ -11,7 +11,7 @@
 #include <astrophoto-toolbox/data/star.h>
 #include <astrophoto-toolbox/data/size.h>
 #include <astrophoto-toolbox/data/transformation.h>
-#include <astrophoto-toolbox/stacking/utils/starsdistance.h>
+#include <astrophoto-toolbox/stacking/utils/starsindex.h>
 #include <astrophoto-toolbox/stacking/utils/votingpair.h>
 
 
@@ -49,14 +49,33 @@ namespace utils {
             Transformation& transformation, double minDistance = 0.0
         );
 
+        //------------------------------------------------------------------------------------
+        /// @brief  Compute the transformation between a list of stars and an already
+        ///         indexed one
+        ///
+        /// Use this method when the transformations of several lists of stars to the same
+        /// reference must be computed: the index of the reference stars can be built once
+        /// and shared (even between several threads).
+        ///
+        /// If a prediction of the transformation is provided (for instance, by a
+        /// 'MotionPredictor'), the stars are first paired with the reference stars the
+        /// nearest to their predicted positions. The matching by triangles is only done
+        /// if no transformation fitting those pairs well enough can be found.
+        //------------------------------------------------------------------------------------
+        bool computeTransformation(
+            const star_list_t& fromStars, const stars_index_ptr_t& toStars,
+            const size2d_t& imageSize, Transformation& transformation,
+            double minDistance = 0.0, const Transformation* prediction = nullptr
+        );
+
         std::vector<std::tuple<point_t, point_t>> pairs() const;
 
     private:
-        bool computeLargeTriangleTransformation(Transformation& transforms, double minDistance);
-
-        void computeStarDistances(const point_list_t& stars, stars_distance_list_t& distances);
+        bool computePredictedTransformation(
+            const Transformation& prediction, Transformation& transforms, double minDistance
+        );
 
-        void initVotingGrid(voting_pair_list_t& votingPairs);
+        bool computeLargeTriangleTransformation(Transformation& transforms, double minDistance);
 
         bool computeSigmaClippingTransformation(
             const voting_pair_list_t& votingPairs, Transformation& transforms
@@ -75,16 +94,13 @@ namespace utils {
         );
 
     private:
-        point_list_t references;
+        stars_index_ptr_t reference;
         point_list_t targets;
         size2d_t imageSize;
-        stars_distance_list_t referenceDistances;
-        stars_distance_list_t targetDistances;
-    	std::vector<int> referenceIndices;
-	    std::vector<int> targetIndices;
         voting_pair_list_t votedPairs;
 
-        static constexpr double MAXSTARDISTANCEDELTA = 2.0;
+        // Maximum distance between the predicted position of a star and its reference star
+        static constexpr double MAXPREDICTIONDISTANCE = 5.0;
     };
 
 }
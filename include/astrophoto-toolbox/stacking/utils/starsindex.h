@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <astrophoto-toolbox/data/star.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Holds the sides of a triangle formed by three stars. Used by the star
+    ///         matching algorithm.
+    ///
+    /// The sides are sorted by decreasing length ('a' >= 'b' >= 'c'), and the stars are
+    /// ordered accordingly: 'star1' is shared by the sides 'a' and 'b', 'star2' by the
+    /// sides 'a' and 'c', and 'star3' is opposite to the side 'a'.
+    //------------------------------------------------------------------------------------
+    struct triangle_t
+    {
+        triangle_t() = default;
+
+        triangle_t(
+            uint16_t star1, uint16_t star2, uint16_t star3, float distance12,
+            float distance13, float distance23
+        );
+
+        float a = 0.0f;
+        float b = 0.0f;
+        float c = 0.0f;
+        uint16_t star1 = 0;
+        uint16_t star2 = 0;
+        uint16_t star3 = 0;
+    };
+
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Holds the data about a list of stars needed by the star matching algorithm
+    ///
+    /// Only the brightest stars are kept. The triangles they form are stored in a grid
+    /// indexed by the ratios of their sides ('b / a' and 'c / a', which don't depend on
+    /// the position, rotation and scale of the triangles), so the triangles similar to
+    /// another one are retrieved without looking at all of them.
+    ///
+    /// An index is immutable once built: the one of a reference frame can be shared by
+    /// all the star matchers (and threads) computing transformations to that frame.
+    //------------------------------------------------------------------------------------
+    class StarsIndex
+    {
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Build the index of a list of stars, using at most the given number of
+        ///         stars
+        //--------------------------------------------------------------------------------
+        StarsIndex(const star_list_t& stars, size_t maxNbStars = MAXSTARS);
+
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of stars in the list used to build the index
+        //--------------------------------------------------------------------------------
+        inline size_t nbStars() const
+        {
+            return nbTotalStars;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the maximum number of stars used by the index
+        //--------------------------------------------------------------------------------
+        inline size_t maxNbStars() const
+        {
+            return maxNbIndexedStars;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the positions of the brightest stars, sorted by decreasing
+        ///         intensity
+        //--------------------------------------------------------------------------------
+        inline const point_list_t& points() const
+        {
+            return positions;
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the number of triangles in the index
+        //--------------------------------------------------------------------------------
+        inline size_t nbTriangles() const
+        {
+            return triangles.size();
+        }
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Call the provided function with all the triangles of the index whose
+        ///         sides are within 'MAXDISTANCEDELTA' pixels of the ones of the given
+        ///         triangle
+        ///
+        /// The function is called as 'callback(const triangle_t& triangle, bool swapped)'.
+        /// 'swapped' indicates that the sides 'b' and 'c' (and thus 'star1' and 'star2')
+        /// of the found triangle correspond to the sides 'c' and 'b' of the given one.
+        //--------------------------------------------------------------------------------
+        template<typename CALLBACK>
+        void findSimilarTriangles(const triangle_t& triangle, CALLBACK callback) const;
+
+    public:
+        //--------------------------------------------------------------------------------
+        /// @brief  Returns the positions of the brightest stars of a list, sorted by
+        ///         decreasing intensity
+        //--------------------------------------------------------------------------------
+        static point_list_t brightestStars(const star_list_t& stars, size_t maxNbStars);
+
+        //--------------------------------------------------------------------------------
+        /// @brief  Indicates if a triangle is elongated enough to be used by the star
+        ///         matching algorithm
+        ///
+        /// This avoids many useless triangles with two big sides and one small side.
+        //--------------------------------------------------------------------------------
+        static inline bool isUsable(const triangle_t& triangle)
+        {
+            return triangle.b < MAXRATIO * triangle.a;
+        }
+
+    public:
+        static constexpr size_t MAXSTARS = 100;
+        static constexpr double MAXDISTANCEDELTA = 2.0;
+        static constexpr double MAXRATIO = 0.9;
+
+    private:
+        static inline int cell(double ratio)
+        {
+            return std::min(std::max(int(ratio * GRIDSIZE), 0), GRIDSIZE - 1);
+        }
+
+    private:
+        static constexpr int GRIDSIZE = 256;
+
+        size_t nbTotalStars;
+        size_t maxNbIndexedStars;
+        point_list_t positions;
+
+        // Triangles sorted by cell of the grid (indexed by 'b / a' and 'c / a'), and
+        // offset of the first triangle of each cell
+        std::vector<triangle_t> triangles;
+        std::vector<uint32_t> offsets;
+    };
+
+
+    //------------------------------------------------------------------------------------
+    /// @brief  Represents a stars index shared between several users
+    //------------------------------------------------------------------------------------
+    typedef std::shared_ptr<const StarsIndex> stars_index_ptr_t;
+
+}
+}
+}
+
+
+#include <astrophoto-toolbox/stacking/utils/starsindex.hpp>
@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <cmath>
+
+namespace astrophototoolbox {
+namespace stacking {
+namespace utils {
+
+
+template<typename CALLBACK>
+void StarsIndex::findSimilarTriangles(const triangle_t& triangle, CALLBACK callback) const
+{
+    const double delta = MAXDISTANCEDELTA;
+    const double a = triangle.a;
+    const double b = triangle.b;
+    const double c = triangle.c;
+
+    // Range of the ratios of the sides of the similar triangles
+    auto minRatio = [a, delta](double side) { return std::max(side - delta, 0.0) / (a + delta); };
+    auto maxRatio = [a, delta](double side) { return (a > delta ? (side + delta) / (a - delta) : 1.0); };
+
+    double minRatioB = minRatio(b);
+    double maxRatioB = maxRatio(b);
+    double minRatioC = minRatio(c);
+    double maxRatioC = maxRatio(c);
+
+    // If 'b' and 'c' are close enough, they might be swapped in the similar triangles
+    const bool swappable = (b - c < 2.0 * delta);
+    if (swappable)
+    {
+        minRatioB = minRatioC;
+        maxRatioC = maxRatioB;
+    }
+
+    const int firstX = cell(minRatioB);
+    const int lastX = cell(maxRatioB);
+    const int firstY = cell(minRatioC);
+    const int lastY = cell(maxRatioC);
+
+    for (int x = firstX; x <= lastX; ++x)
+    {
+        const uint32_t* cellOffsets = offsets.data() + x * GRIDSIZE;
+
+        for (auto it = triangles.begin() + cellOffsets[firstY],
+                  end = triangles.begin() + cellOffsets[lastY + 1]; it != end; ++it)
+        {
+            const triangle_t& candidate = *it;
+
+            if (fabs(candidate.a - a) > delta)
+                continue;
+
+            if ((fabs(candidate.b - b) < delta) && (fabs(candidate.c - c) < delta))
+                callback(candidate, false);
+            else if (swappable && (fabs(candidate.b - c) < delta) && (fabs(candidate.c - b) < delta))
+                callback(candidate, true);
+        }
+    }
+}
+
+}
+}
+}
@@ -29,7 +29,7 @@ namespace utils {
     public:
         VotingPair() = default;
 
-        VotingPair(uint8_t refStar, uint8_t targetStar)
+        VotingPair(uint16_t refStar, uint16_t targetStar)
         : refStar(refStar), targetStar(targetStar)
         {
         }
@@ -62,8 +62,8 @@ namespace utils {
         }
 
     public:
-        uint8_t refStar = 0;
-        uint8_t targetStar = 0;
+        uint16_t refStar = 0;
+        uint16_t targetStar = 0;
         unsigned int nbVotes = 0;
         unsigned int flags = VPFLAG_ACTIVE;
     };
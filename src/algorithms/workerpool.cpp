@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <astrophoto-toolbox/algorithms/workerpool.h>
+#include <algorithm>
+
+
+namespace astrophototoolbox {
+
+/**************************** CONSTRUCTION / DESTRUCTION *******************************/
+
+WorkerPool::WorkerPool(unsigned int nbThreads)
+: size(nbThreads != 0 ? nbThreads : std::max(std::thread::hardware_concurrency(), 1u))
+{
+}
+
+//-----------------------------------------------------------------------------
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    taskCondition.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+
+/************************************** METHODS ****************************************/
+
+void WorkerPool::run(const std::function<void()>& task, unsigned int nbThreads)
+{
+    if ((nbThreads == 0) || (nbThreads > size))
+        nbThreads = size;
+
+    if (nbThreads == 1)
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+
+        // The threads are created the first time they are needed, and know which task
+        // was the last one before them
+        while (threads.size() < nbThreads - 1)
+            threads.emplace_back(&WorkerPool::loop, this, (unsigned int) threads.size(), taskIndex);
+
+        this->task = &task;
+        ++taskIndex;
+        nbParticipants = nbThreads - 1;
+        nbRunning = nbThreads - 1;
+    }
+
+    taskCondition.notify_all();
+
+    task();
+
+    std::unique_lock lock(mutex);
+    doneCondition.wait(lock, [this]{ return nbRunning == 0; });
+    this->task = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+
+void WorkerPool::loop(unsigned int index, uint64_t lastTask)
+{
+    while (true)
+    {
+        const std::function<void()>* current = nullptr;
+
+        {
+            std::unique_lock lock(mutex);
+            taskCondition.wait(lock, [&]{ return stopping || (taskIndex != lastTask); });
+
+            if (stopping)
+                return;
+
+            lastTask = taskIndex;
+
+            // Not needed by this task
+            if (index >= nbParticipants)
+                continue;
+
+            current = task;
+        }
+
+        (*current)();
+
+        {
+            std::lock_guard lock(mutex);
+            --nbRunning;
+        }
+
+        doneCondition.notify_one();
+    }
+}
+
+}
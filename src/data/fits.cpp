@@ -9,6 +9,8 @@
 #include <astrophoto-toolbox/data/fits.h>
 #include <fstream>
 #include <cstring>
+#include <vector>
+#include <type_traits>
 #include <assert.h>
 
 using namespace astrophototoolbox;
@@ -152,12 +154,6 @@ bool FITS::write(Bitmap* bitmap, const std::string& name)
         );
     }
 
-    long fpixel[3] = { 1, 1, 1 };
-    uint16_t v16;
-    uint32_t v32;
-    uint64_t v64;
-    float f32;
-    double f64;
     int64_t bzero = (datatype == TUSHORT
                      ? 0x8000
                      : datatype == TUINT
@@ -167,38 +163,19 @@ bool FITS::write(Bitmap* bitmap, const std::string& name)
                          : 0
     );
 
-    for (fpixel[1] = 1; fpixel[1] <= bitmap->height(); ++fpixel[1])
-    {
-        uint8_t* ptr = bitmap->ptr(fpixel[1] - 1);
-
-        for (fpixel[0] = 1; fpixel[0] <= bitmap->width(); ++fpixel[0])
-        {
-            for (fpixel[2] = 1; fpixel[2] <= bitmap->channels(); ++fpixel[2])
-            {
-                if ((datatype == TBYTE) || (datatype == TFLOAT) || (datatype == TDOUBLE))
-                {
-                    fits_write_pix(_file, datatype, fpixel, 1, ptr, &status);
-                }
-                else if (datatype == TUSHORT)
-                {
-                    v16 = *((uint16_t*) ptr) - bzero;
-                    fits_write_pix(_file, TSHORT, fpixel, 1, &v16, &status);
-                }
-                else if (datatype == TUINT)
-                {
-                    v32 = *((uint32_t*) ptr) - bzero;
-                    fits_write_pix(_file, TINT, fpixel, 1, &v32, &status);
-                }
-                else if (datatype == TULONG)
-                {
-                    v64 = *((uint64_t*) ptr) - bzero;
-                    fits_write_pix(_file, TLONG, fpixel, 1, &v64, &status);
-                }
-
-                ptr += bitmap->channelSize();
-            }
-        }
-    }
+    // Unsigned integers are stored as signed ones, shifted by BZERO
+    if (datatype == TBYTE)
+        writePixels<uint8_t, uint8_t>(bitmap, TBYTE, 0, status);
+    else if (datatype == TUSHORT)
+        writePixels<uint16_t, int16_t>(bitmap, TSHORT, 0x8000, status);
+    else if (datatype == TUINT)
+        writePixels<uint32_t, int32_t>(bitmap, TINT, 0x80000000, status);
+    else if (datatype == TULONG)
+        writePixels<uint64_t, int64_t>(bitmap, TLONGLONG, 0x8000000000000000, status);
+    else if (datatype == TFLOAT)
+        writePixels<float, float>(bitmap, TFLOAT, 0.0f, status);
+    else if (datatype == TDOUBLE)
+        writePixels<double, double>(bitmap, TDOUBLE, 0.0, status);
 
     if (bzero != 0)
         fits_write_key(_file, TUINT, "BZERO", &bzero, "zero point in scaling equation", &status);
@@ -715,21 +692,16 @@ Bitmap* FITS::readBitmapFromCurrentHDU()
         );
     }
 
-    long fpixel[3] = { 1, 1, 1 };
-
-    for (fpixel[1] = 1; fpixel[1] <= dest->height(); ++fpixel[1])
-    {
-        uint8_t* ptr = dest->ptr(fpixel[1] - 1);
-
-        for (fpixel[0] = 1; fpixel[0] <= dest->width(); ++fpixel[0])
-        {
-            for (fpixel[2] = 1; fpixel[2] <= dest->channels(); ++fpixel[2])
-            {
-                fits_read_pix(_file, datatype, fpixel, 1, nullptr, ptr, nullptr, &status);
-                ptr += dest->channelSize();
-            }
-        }
-    }
+    if (datatype == TBYTE)
+        readPixels<uint8_t>(dest, TBYTE, status);
+    else if (datatype == TUSHORT)
+        readPixels<uint16_t>(dest, TUSHORT, status);
+    else if (datatype == TUINT)
+        readPixels<uint32_t>(dest, TUINT, status);
+    else if (datatype == TFLOAT)
+        readPixels<float>(dest, TFLOAT, status);
+    else if (datatype == TDOUBLE)
+        readPixels<double>(dest, TDOUBLE, status);
 
     if (status != 0)
     {
@@ -959,3 +931,116 @@ bool FITS::gotoHDU(int index, int type, const std::string& datatype)
 
     return false;
 }
+
+//-----------------------------------------------------------------------------
+
+template<typename T, typename S>
+void FITS::writePixels(const Bitmap* bitmap, int datatype, T offset, int& status)
+{
+    const unsigned int width = bitmap->width();
+    const unsigned int height = bitmap->height();
+    const unsigned int channels = bitmap->channels();
+
+    // FITS images are stored as planes (one per channel) of contiguous rows
+    LONGLONG firstElement = 1;
+
+    // Fast path: no conversion needed, write the rows directly from the bitmap
+    if ((channels == 1) && (offset == T(0)) && std::is_same_v<T, S>)
+    {
+        if (bitmap->bytesPerRow() == width * sizeof(T))
+        {
+            fits_write_img(
+                _file, datatype, firstElement, LONGLONG(width) * height,
+                (void*) bitmap->ptr(), &status
+            );
+            return;
+        }
+
+        for (unsigned int y = 0; (y < height) && (status == 0); ++y)
+        {
+            fits_write_img(_file, datatype, firstElement, width, (void*) bitmap->ptr(y), &status);
+            firstElement += width;
+        }
+
+        return;
+    }
+
+    // Otherwise convert (and de-interleave) each row of each channel in a buffer
+    std::vector<S> buffer(width);
+
+    for (unsigned int c = 0; c < channels; ++c)
+    {
+        for (unsigned int y = 0; (y < height) && (status == 0); ++y)
+        {
+            const T* src = ((const T*) bitmap->ptr(y)) + c;
+            S* dest = buffer.data();
+
+            if (channels == 3)
+            {
+                for (unsigned int x = 0; x < width; ++x)
+                    dest[x] = S(T(src[x * 3] - offset));
+            }
+            else
+            {
+                for (unsigned int x = 0; x < width; ++x)
+                    dest[x] = S(T(src[x] - offset));
+            }
+
+            fits_write_img(_file, datatype, firstElement, width, buffer.data(), &status);
+            firstElement += width;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename T>
+void FITS::readPixels(Bitmap* bitmap, int datatype, int& status)
+{
+    const unsigned int width = bitmap->width();
+    const unsigned int height = bitmap->height();
+    const unsigned int channels = bitmap->channels();
+
+    // FITS images are stored as planes (one per channel) of contiguous rows. Note that
+    // cfitsio takes care of the BZERO offset itself when reading.
+    LONGLONG firstElement = 1;
+
+    // Fast path: read the rows directly into the bitmap
+    if (channels == 1)
+    {
+        if (bitmap->bytesPerRow() == width * sizeof(T))
+        {
+            fits_read_img(
+                _file, datatype, firstElement, LONGLONG(width) * height, nullptr,
+                bitmap->ptr(), nullptr, &status
+            );
+            return;
+        }
+
+        for (unsigned int y = 0; (y < height) && (status == 0); ++y)
+        {
+            fits_read_img(_file, datatype, firstElement, width, nullptr, bitmap->ptr(y), nullptr, &status);
+            firstElement += width;
+        }
+
+        return;
+    }
+
+    // Otherwise read each row of each channel in a buffer, and interleave it
+    std::vector<T> buffer(width);
+
+    for (unsigned int c = 0; c < channels; ++c)
+    {
+        for (unsigned int y = 0; (y < height) && (status == 0); ++y)
+        {
+            fits_read_img(_file, datatype, firstElement, width, nullptr, buffer.data(), nullptr, &status);
+            firstElement += width;
+
+            const T* src = buffer.data();
+            T* dest = ((T*) bitmap->ptr(y)) + c;
+
+            for (unsigned int x = 0; x < width; ++x)
+                dest[x * 3] = src[x];
+        }
+    }
+}
@@ -8,6 +8,7 @@
 
 #include <astrophoto-toolbox/data/transformation.h>
 #include <algorithm>
+#include <cmath>
 
 using namespace astrophototoolbox;
 
@@ -49,6 +50,67 @@ rect_t Transformation::transform(const rect_t& rect) const noexcept
 
 //-----------------------------------------------------------------------------
 
+transformation_class_t Transformation::classify(
+    const size2d_t& size, double tolerance
+) const noexcept
+{
+    // The difference between two transformations without any 'X * Y' term and this one
+    // is bilinear, so its maximum is reached at one of the corners of the bitmap
+    const point_t corners[4] = {
+        point_t(0, 0),
+        point_t(size.width, 0),
+        point_t(0, size.height),
+        point_t(size.width, size.height),
+    };
+
+    point_t transformed[4];
+    for (int i = 0; i < 4; ++i)
+        transformed[i] = transform(corners[i]);
+
+    const double dX = transformed[0].x;
+    const double dY = transformed[0].y;
+
+    auto matches = [&](double cosAngle, double sinAngle)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            const point_t& c = corners[i];
+            const double x = cosAngle * c.x - sinAngle * c.y + dX;
+            const double y = sinAngle * c.x + cosAngle * c.y + dY;
+
+            if ((std::abs(transformed[i].x - x) > tolerance) ||
+                (std::abs(transformed[i].y - y) > tolerance))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    if (matches(1.0, 0.0))
+    {
+        if ((std::abs(dX) <= tolerance) && (std::abs(dY) <= tolerance))
+            return TRANSFORMATION_IDENTITY;
+
+        if ((std::abs(dX - std::round(dX)) <= tolerance) &&
+            (std::abs(dY - std::round(dY)) <= tolerance))
+        {
+            return TRANSFORMATION_INTEGER_SHIFT;
+        }
+
+        return TRANSFORMATION_SUBPIXEL_SHIFT;
+    }
+
+    const double angle = atan2(transformed[1].y - dY, transformed[1].x - dX);
+    if (matches(cos(angle), sin(angle)))
+        return TRANSFORMATION_RIGID;
+
+    return TRANSFORMATION_GENERIC;
+}
+
+//-----------------------------------------------------------------------------
+
 double Transformation::angle(int width) const noexcept
 {
     double angle;
@@ -71,3 +133,94 @@ void Transformation::offsets(double& dX, double& dY) const noexcept
 	dX = a0 * xWidth;
 	dY = b0 * yWidth;
 }
+
+//-----------------------------------------------------------------------------
+
+bool Transformation::computeSourceCoordinates(
+    unsigned int x, unsigned int y, unsigned int count, double* xs, double* ys,
+    bool bilinear
+) const noexcept
+{
+    // Coefficients of the transformation in pixel coordinates:
+    //   x' = A0 + A1 * x + A2 * y + A3 * x * y
+    //   y' = B0 + B1 * x + B2 * y + B3 * x * y
+    const double A0 = a0 * xWidth;
+    const double A1 = a1;
+    const double A2 = a2 * xWidth / yWidth;
+    const double A3 = a3 / yWidth;
+    const double B0 = b0 * yWidth;
+    const double B1 = b1 * yWidth / xWidth;
+    const double B2 = b2;
+    const double B3 = b3 / xWidth;
+
+    const double det = A1 * B2 - A2 * B1;
+    if (std::abs(det) < 1e-12)
+        return false;
+
+    // Inverse of the affine part, evaluated at the first pixel, and the increment
+    // between two consecutive pixels
+    const double u = double(x) - A0;
+    const double v = double(y) - B0;
+
+    const double x0 = (B2 * u - A2 * v) / det;
+    const double y0 = (A1 * v - B1 * u) / det;
+    const double dx = B2 / det;
+    const double dy = -B1 / det;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        xs[i] = x0 + i * dx;
+        ys[i] = y0 + i * dy;
+    }
+
+    if (!bilinear || ((A3 == 0.0) && (B3 == 0.0)))
+        return true;
+
+    // Bilinear transformation: refine the coordinates with Newton's method, starting
+    // from the solution of the previous pixel, extrapolated using the two previous ones
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        double sx = xs[i];
+        double sy = ys[i];
+
+        if (i >= 2)
+        {
+            sx = 2.0 * xs[i - 1] - xs[i - 2];
+            sy = 2.0 * ys[i - 1] - ys[i - 2];
+        }
+        else if (i == 1)
+        {
+            sx = xs[0] + dx;
+            sy = ys[0] + dy;
+        }
+
+        for (int iter = 0; iter < 10; ++iter)
+        {
+            const double fx = A0 + A1 * sx + A2 * sy + A3 * sx * sy - double(x + i);
+            const double fy = B0 + B1 * sx + B2 * sy + B3 * sx * sy - double(y);
+
+            const double j11 = A1 + A3 * sy;
+            const double j12 = A2 + A3 * sx;
+            const double j21 = B1 + B3 * sy;
+            const double j22 = B2 + B3 * sx;
+
+            const double jdet = j11 * j22 - j12 * j21;
+            if (std::abs(jdet) < 1e-12)
+                break;
+
+            const double deltaX = (j22 * fx - j12 * fy) / jdet;
+            const double deltaY = (j11 * fy - j21 * fx) / jdet;
+
+            sx -= deltaX;
+            sy -= deltaY;
+
+            if ((std::abs(deltaX) < 1e-9) && (std::abs(deltaY) < 1e-9))
+                break;
+        }
+
+        xs[i] = sx;
+        ys[i] = sy;
+    }
+
+    return true;
+}
@@ -31,43 +31,81 @@ double getConversionFactor(range_t from, range_t to)
 
 //-----------------------------------------------------------------------------
 
-DoubleGrayBitmap* computeLuminanceBitmap(Bitmap* bitmap)
+template<class LUMINANCE, typename T>
+void computeLuminance(const TypedBitmap<T, 3>* color, LUMINANCE* luminance)
 {
-    // Only one channel: convert to the output format
-    if (bitmap->channels() == 1)
-        return new DoubleGrayBitmap(bitmap, RANGE_ONE);    
+    typedef typename LUMINANCE::type_t type_t;
 
-    // Ensure the bitmap is in the correct format
-    DoubleColorBitmap* color = requiresFormat<DoubleColorBitmap>(bitmap, RANGE_ONE);
+    const double factor = getConversionFactor(color->range(), RANGE_ONE);
 
-    // Compute the luminance
-    DoubleGrayBitmap* luminance = new DoubleGrayBitmap(color->width(), color->height());
+    // The minimum and maximum values don't change when converted to the range of the
+    // luminance, so only them need to be converted
     for (unsigned int y = 0; y < color->height(); ++y)
     {
-        double* src = color->data(y);
-        double* dest = luminance->data(y);
+        const T* src = color->data(y);
+        type_t* dest = luminance->data(y);
 
         for (unsigned int x = 0; x < color->width(); ++x)
         {
-            double minv = std::min(src[0], std::min(src[1], src[2]));
-            double maxv = std::max(src[0], std::max(src[1], src[2]));
+            double minv = double(std::min(src[0], std::min(src[1], src[2]))) * factor;
+            double maxv = double(std::max(src[0], std::max(src[1], src[2]))) * factor;
 
-            *dest = (minv + maxv) * 0.5;
+            *dest = type_t((minv + maxv) * 0.5);
 
             src += 3;
             ++dest;
         }
     }
+}
 
-    // Cleanup, if necessary
-    if (color != bitmap)
-        delete color;
+//-----------------------------------------------------------------------------
+
+template<class LUMINANCE>
+LUMINANCE* computeLuminance(Bitmap* bitmap)
+{
+    // Only one channel: convert to the output format
+    if (bitmap->channels() == 1)
+        return new LUMINANCE(bitmap, RANGE_ONE);
+
+    // Compute the luminance in one pass, directly from the values of the bitmap
+    LUMINANCE* luminance = new LUMINANCE(bitmap->width(), bitmap->height());
+
+    if (bitmap->isFloatingPoint())
+    {
+        if (bitmap->channelSize() == 4)
+            computeLuminance(dynamic_cast<FloatColorBitmap*>(bitmap), luminance);
+        else if (bitmap->channelSize() == 8)
+            computeLuminance(dynamic_cast<DoubleColorBitmap*>(bitmap), luminance);
+    }
+    else
+    {
+        if (bitmap->channelSize() == 1)
+            computeLuminance(dynamic_cast<UInt8ColorBitmap*>(bitmap), luminance);
+        else if (bitmap->channelSize() == 2)
+            computeLuminance(dynamic_cast<UInt16ColorBitmap*>(bitmap), luminance);
+        else if (bitmap->channelSize() == 4)
+            computeLuminance(dynamic_cast<UInt32ColorBitmap*>(bitmap), luminance);
+    }
 
     return luminance;
 }
 
 //-----------------------------------------------------------------------------
 
+DoubleGrayBitmap* computeLuminanceBitmap(Bitmap* bitmap)
+{
+    return computeLuminance<DoubleGrayBitmap>(bitmap);
+}
+
+//-----------------------------------------------------------------------------
+
+FloatGrayBitmap* computeFloatLuminanceBitmap(Bitmap* bitmap)
+{
+    return computeLuminance<FloatGrayBitmap>(bitmap);
+}
+
+//-----------------------------------------------------------------------------
+
 void removeHotPixels(Bitmap* bitmap)
 {
     const double hotFactor = 4.0;
@@ -0,0 +1,305 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <astrophoto-toolbox/stacking/utils/cubefile.h>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <cerrno>
+#endif
+
+using namespace astrophototoolbox;
+using namespace stacking;
+using namespace utils;
+
+
+static size_t pageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+
+CubeFile::~CubeFile()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+
+bool CubeFile::create(const std::filesystem::path& filename, size_t size)
+{
+    close();
+
+    this->filename = filename;
+
+#ifdef _WIN32
+    file = std::fopen(filename.string().c_str(), "w+b");
+    if (!file)
+        return false;
+#else
+    fd = open(filename.string().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return false;
+#endif
+
+    if (!resize(size))
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool CubeFile::resize(size_t size)
+{
+    if (!isOpened())
+        return false;
+
+#ifdef _WIN32
+    if (_chsize_s(_fileno(file), size) != 0)
+        return false;
+#else
+    if (ftruncate(fd, size) != 0)
+        return false;
+
+    #ifdef __linux__
+        // Reserve the blocks now, to avoid fragmentation (not supported by all
+        // filesystems, the file is just sparse in that case)
+        if (size > fileSize)
+            posix_fallocate(fd, fileSize, size - fileSize);
+    #endif
+#endif
+
+    fileSize = size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool CubeFile::write(const void* data, size_t size, size_t offset)
+{
+    if (!isOpened() || (offset + size > fileSize))
+        return false;
+
+#ifdef _WIN32
+    if (_fseeki64(file, offset, SEEK_SET) != 0)
+        return false;
+
+    return (fwrite(data, size, 1, file) == 1);
+#else
+    const uint8_t* src = (const uint8_t*) data;
+
+    while (size > 0)
+    {
+        ssize_t nb = pwrite(fd, src, size, offset);
+        if (nb < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        src += nb;
+        size -= nb;
+        offset += nb;
+    }
+
+    return true;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+const uint8_t* CubeFile::map() const
+{
+    std::lock_guard lock(mappingMutex);
+
+    if (!isOpened() || (fileSize == 0))
+        return nullptr;
+
+    if (nbMappingReferences == 0)
+    {
+#ifdef _WIN32
+        // The written data must be visible through the mapping
+        if (fflush(file) != 0)
+            return nullptr;
+
+        HANDLE handle = CreateFileMappingA(
+            (HANDLE) _get_osfhandle(_fileno(file)), nullptr, PAGE_READONLY,
+            DWORD(uint64_t(fileSize) >> 32), DWORD(uint64_t(fileSize) & 0xFFFFFFFF), nullptr
+        );
+
+        if (!handle)
+            return nullptr;
+
+        void* ptr = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, fileSize);
+        if (!ptr)
+        {
+            CloseHandle(handle);
+            return nullptr;
+        }
+
+        mappingHandle = handle;
+        mapping = (uint8_t*) ptr;
+#else
+        void* ptr = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+            return nullptr;
+
+        mapping = (uint8_t*) ptr;
+
+        madvise(mapping, fileSize, MADV_SEQUENTIAL);
+#endif
+    }
+
+    ++nbMappingReferences;
+    return mapping;
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::unmap() const
+{
+    std::lock_guard lock(mappingMutex);
+
+    if ((nbMappingReferences == 0) || (--nbMappingReferences > 0))
+        return;
+
+    removeMapping();
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::prefetch(size_t offset, size_t size) const
+{
+#ifndef _WIN32
+    if (!mapping)
+        return;
+
+    // madvise() requires an address aligned on a page
+    const size_t start = offset - offset % pageSize();
+
+    madvise(mapping + start, size + offset - start, MADV_WILLNEED);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::load(size_t offset, size_t size) const
+{
+    if (!mapping || (size == 0))
+        return;
+
+    prefetch(offset, size);
+
+    // Touch each page, to wait until they are all read
+    const size_t step = pageSize();
+    const size_t start = offset - offset % step;
+
+    uint8_t value = 0;
+    for (size_t i = start; i < offset + size; i += step)
+        value += mapping[i];
+
+    // Prevent the compiler from removing the loop
+    volatile uint8_t sink = 0;
+    sink = value;
+    (void) sink;
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::release(size_t offset, size_t size) const
+{
+    if (!mapping)
+        return;
+
+    // Only release the pages entirely contained in the range
+    const size_t step = pageSize();
+    const size_t start = (offset + step - 1) / step * step;
+    const size_t end = (offset + size) / step * step;
+
+    if (end <= start)
+        return;
+
+#ifdef _WIN32
+    // Unlocking pages that aren't locked removes them from the working set
+    VirtualUnlock(mapping + start, end - start);
+#else
+    madvise(mapping + start, end - start, MADV_DONTNEED);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::close()
+{
+    {
+        std::lock_guard lock(mappingMutex);
+
+        nbMappingReferences = 0;
+        removeMapping();
+    }
+
+#ifdef _WIN32
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+#else
+    if (fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+
+    if (!filename.empty())
+    {
+        std::filesystem::remove(filename);
+        filename.clear();
+    }
+
+    fileSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void CubeFile::removeMapping() const
+{
+    if (!mapping)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle((HANDLE) mappingHandle);
+    mappingHandle = nullptr;
+#else
+    munmap(mapping, fileSize);
+#endif
+
+    mapping = nullptr;
+}
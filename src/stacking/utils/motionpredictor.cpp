@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <astrophoto-toolbox/stacking/utils/motionpredictor.h>
+
+using namespace astrophototoolbox;
+using namespace stacking;
+using namespace utils;
+
+
+void MotionPredictor::add(const Transformation& transformation)
+{
+    previous = last;
+    last = transformation;
+    ++nbTransformations;
+}
+
+//-----------------------------------------------------------------------------
+
+bool MotionPredictor::predict(Transformation& prediction) const
+{
+    if (nbTransformations == 0)
+        return false;
+
+    prediction = last;
+
+    if ((nbTransformations >= 2) && (previous.xWidth == last.xWidth) &&
+        (previous.yWidth == last.yWidth))
+    {
+        prediction.a0 = 2.0 * last.a0 - previous.a0;
+        prediction.a1 = 2.0 * last.a1 - previous.a1;
+        prediction.a2 = 2.0 * last.a2 - previous.a2;
+        prediction.a3 = 2.0 * last.a3 - previous.a3;
+        prediction.b0 = 2.0 * last.b0 - previous.b0;
+        prediction.b1 = 2.0 * last.b1 - previous.b1;
+        prediction.b2 = 2.0 * last.b2 - previous.b2;
+        prediction.b3 = 2.0 * last.b3 - previous.b3;
+    }
+
+    return true;
+}
@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <astrophoto-toolbox/stacking/utils/normalequations.h>
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <algorithm>
+
+using namespace astrophototoolbox;
+using namespace stacking;
+using namespace utils;
+
+
+NormalEquations::NormalEquations(double width, double height)
+: width(width), height(height)
+{
+}
+
+//-----------------------------------------------------------------------------
+
+void NormalEquations::clear()
+{
+    nbPairs = 0;
+
+    std::fill(std::begin(normal), std::end(normal), 0.0);
+    std::fill(std::begin(rhsX), std::end(rhsX), 0.0);
+    std::fill(std::begin(rhsY), std::end(rhsY), 0.0);
+}
+
+//-----------------------------------------------------------------------------
+
+bool NormalEquations::solve(Transformation& transformation) const
+{
+    transformation.xWidth = width;
+    transformation.yWidth = height;
+
+    if (nbPairs < 4)
+        return false;
+
+    Eigen::Matrix4d M;
+    Eigen::Matrix<double, 4, 2> B;
+
+    for (int i = 0, k = 0; i < 4; ++i)
+    {
+        for (int j = i; j < 4; ++j, ++k)
+        {
+            M(i, j) = normal[k];
+            M(j, i) = normal[k];
+        }
+
+        B(i, 0) = rhsX[i];
+        B(i, 1) = rhsY[i];
+    }
+
+    // Solve both axes using the same decomposition
+    Eigen::FullPivLU<Eigen::Matrix4d> lu(M);
+    if (!lu.isInvertible())
+        return false;
+
+    Eigen::Matrix<double, 4, 2> A = lu.solve(B);
+
+    transformation.a0 = A(0, 0);
+    transformation.a1 = A(1, 0);
+    transformation.a2 = A(2, 0);
+    transformation.a3 = A(3, 0);
+    transformation.b0 = A(0, 1);
+    transformation.b1 = A(1, 1);
+    transformation.b2 = A(2, 1);
+    transformation.b3 = A(3, 1);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void NormalEquations::update(const point_t& from, const point_t& to, double weight)
+{
+    const double X = from.x / width;
+    const double Y = from.y / height;
+    const double m[4] = { 1.0, X, Y, X * Y };
+
+    const double toX = weight * to.x / width;
+    const double toY = weight * to.y / height;
+
+    for (int i = 0, k = 0; i < 4; ++i)
+    {
+        const double wm = weight * m[i];
+
+        for (int j = i; j < 4; ++j, ++k)
+            normal[k] += wm * m[j];
+
+        rhsX[i] += m[i] * toX;
+        rhsY[i] += m[i] * toY;
+    }
+}
@@ -17,6 +17,10 @@
 #include <astrophoto-toolbox/images/helpers.h>
 #include <array>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace astrophototoolbox;
 using namespace stacking;
@@ -53,7 +57,14 @@ struct searchEntry_t {
 
 const star_list_t Registration::registerBitmap(Bitmap* bitmap, int luminancyThreshold)
 {
-    DoubleGrayBitmap* luminance = computeLuminanceBitmap(bitmap);
+    // A luminance bitmap in the correct format can be used directly
+    FloatGrayBitmap* luminance = dynamic_cast<FloatGrayBitmap*>(bitmap);
+    if (!luminance || (luminance->range() != RANGE_ONE) ||
+        (luminance->bytesPerRow() != luminance->width() * sizeof(float)))
+    {
+        luminance = computeFloatLuminanceBitmap(bitmap);
+    }
+
     double median = computeMedian(luminance);
 
     this->luminancyThreshold = std::min(std::max(luminancyThreshold, -1), 100);
@@ -65,9 +76,13 @@ const star_list_t Registration::registerBitmap(Bitmap* bitmap, int luminancyThre
     else
         registerBitmapAndSearchThreshold(luminance, median, stars);
 
+    // Sort the stars by position first, so the order of the stars with the same
+    // intensity doesn't depend on the order in which they were found
+    std::sort(stars.begin(), stars.end());
 	std::sort(stars.begin(), stars.end(), star_t::compareIntensity);
 
-    delete luminance;
+    if (luminance != bitmap)
+        delete luminance;
 
     return stars;
 }
@@ -75,102 +90,47 @@ const star_list_t Registration::registerBitmap(Bitmap* bitmap, int luminancyThre
 //-----------------------------------------------------------------------------
 
 void Registration::registerBitmapWithFixedThreshold(
-    DoubleGrayBitmap* luminance, double median, star_list_t& stars
+    FloatGrayBitmap* luminance, double median, star_list_t& stars
 )
 {
-    const int rectSize = STARMAXSIZE * 5;
-    const int stepSize = rectSize / 2;
-    const int separation = 3;
-    const int width = luminance->width() - 2 * STARMAXSIZE;
-    const int height = luminance->height() - 2 * STARMAXSIZE;
-    const int nbRectsX = (width - 1) / stepSize + 1;
-    const int nbRectsY = (height - 1) / stepSize + 1;
-
-    const int rightColumn = luminance->width() - STARMAXSIZE;
-    const int bottomRow = luminance->height() - STARMAXSIZE;
-
-    star_set_t foundStars;
-    int nbStars = 0;
+    tile_list_t tiles;
+    star_grid_t foundStars;
+    foundStars.setup(luminance->width(), luminance->height());
 
     double minLuminancy = double(luminancyThreshold) / 100.0;
 
-    for (int row = 0; row < nbRectsY; ++row)
-    {
-        const int top = STARMAXSIZE + row * stepSize;
-        const int bottom = std::min(bottomRow, top + rectSize);
-
-        for (int col = 0; (col < nbRectsX) && (nbStars <= 100); ++col)
-        {
-            nbStars += registerRect(
-                luminance,
-                rect_t(
-                    STARMAXSIZE + col * stepSize,
-                    top,
-                    std::min(rightColumn, STARMAXSIZE + col * stepSize + rectSize),
-                    bottom),
-                median,
-                minLuminancy,
-                foundStars
-            );
-        }
-    }
+    registerRects(luminance, median, minLuminancy, tiles, foundStars);
 
-    stars.assign(foundStars.cbegin(), foundStars.cend());
+    stars = std::move(foundStars.stars);
 }
 
 //-----------------------------------------------------------------------------
 
 void Registration::registerBitmapAndSearchThreshold(
-    DoubleGrayBitmap* luminance, double median, star_list_t& stars
+    FloatGrayBitmap* luminance, double median, star_list_t& stars
 )
 {
-    const int rectSize = STARMAXSIZE * 5;
-    const int stepSize = rectSize / 2;
-    const int separation = 3;
-    const int width = luminance->width() - 2 * STARMAXSIZE;
-    const int height = luminance->height() - 2 * STARMAXSIZE;
-    const int nbRectsX = (width - 1) / stepSize + 1;
-    const int nbRectsY = (height - 1) / stepSize + 1;
-
-    const int rightColumn = luminance->width() - STARMAXSIZE;
-    const int bottomRow = luminance->height() - STARMAXSIZE;
-
     std::set<searchEntry_t> searchGrid;
     bool found = false;
 
+    // The candidate stars are reused by all the iterations, only the pixels that weren't
+    // above the previous thresholds must be processed
+    tile_list_t tiles;
+
     luminancyThreshold = 10;
 
     while (true)
     {
-        star_set_t foundStars;
-        int nbStars = 0;
+        star_grid_t foundStars;
+        foundStars.setup(luminance->width(), luminance->height());
 
         double minLuminancy = double(luminancyThreshold) / 100.0;
 
-        for (int row = 0; (row < nbRectsY) && (nbStars <= 100); ++row)
-        {
-            const int top = STARMAXSIZE + row * stepSize;
-            const int bottom = std::min(bottomRow, top + rectSize);
-
-            for (int col = 0; (col < nbRectsX) && (nbStars <= 100); ++col)
-            {
-                nbStars += registerRect(
-                    luminance,
-                    rect_t(
-                        STARMAXSIZE + col * stepSize,
-                        top,
-                        std::min(rightColumn, STARMAXSIZE + col * stepSize + rectSize),
-                        bottom),
-                    median,
-                    minLuminancy,
-                    foundStars
-                );
-            }
-        }
+        int nbStars = registerRects(luminance, median, minLuminancy, tiles, foundStars);
 
         if (found)
         {
-            stars.assign(foundStars.cbegin(), foundStars.cend());
+            stars = std::move(foundStars.stars);
             break;
         }
 
@@ -207,7 +167,7 @@ void Registration::registerBitmapAndSearchThreshold(
             }
             else
             {
-                stars.assign(foundStars.cbegin(), foundStars.cend());
+                stars = std::move(foundStars.stars);
                 break;
             }
         }
@@ -216,199 +176,302 @@ void Registration::registerBitmapAndSearchThreshold(
 
 //-----------------------------------------------------------------------------
 
-int Registration::registerRect(
-    const DoubleGrayBitmap* bitmap, const rect_t &rect, double background,
-    double minLuminancy, star_set_t& stars
+int Registration::registerRects(
+    const FloatGrayBitmap* bitmap, double background, double minLuminancy,
+    tile_list_t& tiles, star_grid_t& stars
 ) const
 {
-    double maxIntensity = std::numeric_limits<double>::min();
-    size_t nbStars = 0;
-
-    // Copy the content of the rectangle in a local buffer
-    const int width = rect.width();
-    std::vector<double> values(width * rect.height());
-    for (int y = rect.top, index = 0; y < rect.bottom; ++y)
+    if (tiles.empty())
     {
-        const double* ptr = bitmap->data(rect.left, y);
+        const int rectSize = STARMAXSIZE * 5;
+        const int stepSize = rectSize / 2;
+        const int width = bitmap->width() - 2 * STARMAXSIZE;
+        const int height = bitmap->height() - 2 * STARMAXSIZE;
+        const int nbRectsX = (width - 1) / stepSize + 1;
+        const int nbRectsY = (height - 1) / stepSize + 1;
+
+        const int rightColumn = bitmap->width() - STARMAXSIZE;
+        const int bottomRow = bitmap->height() - STARMAXSIZE;
 
-        for (int x = 0; x < width; ++x, ++index)
+        for (int row = 0; row < nbRectsY; ++row)
         {
-            values[index] = *ptr;
-            maxIntensity = std::max(maxIntensity, *ptr);
-            ++ptr;
+            const int top = STARMAXSIZE + row * stepSize;
+            const int bottom = std::min(bottomRow, top + rectSize);
+
+            for (int col = 0; col < nbRectsX; ++col)
+            {
+                tile_t tile;
+                tile.rect = rect_t(
+                    STARMAXSIZE + col * stepSize,
+                    top,
+                    std::min(rightColumn, STARMAXSIZE + col * stepSize + rectSize),
+                    bottom
+                );
+
+                tiles.push_back(std::move(tile));
+            }
         }
     }
 
-    const auto getValue = [&values, rect, width](const int x, const int y) -> double
-    {
-        return values[(y - rect.top) * width + x - rect.left];
-    };
+    if (tiles.empty())
+        return 0;
 
-    // Luminance-based check to determine if bright enough stars are in the rectangle
     const double intensityThreshold = minLuminancy + background;
-    if (maxIntensity < intensityThreshold)
-        return 0;
 
-    // Find how many wanabee stars are existing above 90% maximum luminance
-    for (int deltaRadius = 0; deltaRadius < 4; ++deltaRadius)
+    // The missing candidates of each rectangle are searched by the worker threads (in
+    // the order of the rectangles), while they are processed here as soon as they are
+    // available
+    std::vector<bool> done(tiles.size(), false);
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<size_t> nextTile = 0;
+    std::atomic<bool> stop = false;
+
+    auto worker = [&]()
     {
-        for (int y = rect.top; y < rect.bottom; ++y)
+        for (size_t i = nextTile++; (i < tiles.size()) && !stop; i = nextTile++)
         {
-            for (int x = rect.left; x < rect.right; ++x)
+            tile_t& tile = tiles[i];
+
+            if (tile.minIntensity > intensityThreshold)
+            {
+                detectCandidates(
+                    bitmap, tile.rect, background, intensityThreshold, tile.minIntensity,
+                    tile.candidates
+                );
+
+                tile.minIntensity = intensityThreshold;
+            }
+
             {
-                const double intensity = getValue(x, y);
+                std::lock_guard lock(mutex);
+                done[i] = true;
+            }
 
-                if (x == 265)
-                    x = 265;
+            condition.notify_all();
+        }
+    };
 
-                if (intensity < intensityThreshold)
-                    continue;
+    unsigned int nbWorkers = (nbThreads != 0 ? nbThreads : std::thread::hardware_concurrency());
+    nbWorkers = std::max(std::min(nbWorkers, (unsigned int) tiles.size()), 1u);
 
-                // Check that this pixel is not already used in a wanabee star
-                bool isNew = true;
-                for (star_set_t::const_iterator it = stars.lower_bound(star_t(x - STARMAXSIZE, 0));
-                     it != stars.cend() && isNew; ++it)
-                {
-                    if (it->contains(x, y))
-                        isNew = false;
-                    else if (it->position.x > x + STARMAXSIZE)
-                        break;
-                }
+    std::vector<std::thread> threads;
+    threads.reserve(nbWorkers);
 
-                if (!isNew)
-                    continue;
+    for (unsigned int i = 0; i < nbWorkers; ++i)
+        threads.emplace_back(worker);
 
-                // Search around the point until intensity is divided by 2
-                std::array<pixel_direction_t, 8> directions{{{0, -1}, {1, 0}, {0, 1}, {-1, 0}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}}};
+    int nbStars = 0;
 
-                bool brighterPixel = false;
-                bool allOk = true;
-                int maxRadius = 0;
+    for (size_t i = 0; (i < tiles.size()) && (nbStars <= 100); ++i)
+    {
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [&]{ return done[i]; });
+        }
 
-                for (int testedRadius = 1; (testedRadius < STARMAXSIZE) && allOk && !brighterPixel; ++testedRadius)
-                {
-                    for (auto &pixel : directions)
-                        pixel.intensity = *bitmap->data(x + pixel.xDir * testedRadius, y + pixel.yDir * testedRadius);
+        nbStars += registerRect(tiles[i].candidates, intensityThreshold, stars);
+    }
 
-                    allOk = false;
-                    for (auto &pixel : directions)
-                    {
-                        if (pixel.ok)
-                        {
-                            if (pixel.intensity - background < 0.25 * (intensity - background))
-                            {
-                                pixel.radius = testedRadius;
-                                --pixel.ok;
-                                maxRadius = std::max(maxRadius, testedRadius);
-                            }
-                            else if (pixel.intensity > 1.05 * intensity)
-                            {
-                                brighterPixel = true;
-                            }
-                            else if (pixel.intensity > intensity)
-                            {
-                                ++pixel.nbBrighterPixels;
-                            }
-                        }
+    stop = true;
 
-                        if (pixel.ok)
-                            allOk = true;
+    for (auto& thread : threads)
+        thread.join();
 
-                        if (pixel.nbBrighterPixels > 2)
-                            brighterPixel = true;
+    return nbStars;
+}
 
-                        if (brighterPixel)
-                            break;
-                    }
-                }
+//-----------------------------------------------------------------------------
 
-                if (allOk || brighterPixel || (maxRadius <= 2))
-                    continue;
+void Registration::detectCandidates(
+    const FloatGrayBitmap* bitmap, const rect_t &rect, double background,
+    double minIntensity, double maxIntensity, candidate_list_t& candidates
+) const
+{
+    const size_t nbPreviousCandidates = candidates.size();
 
-                // Check the roundness of the wanabee star
-                // Radiuses should be within deltaRadius pixels of each others
-                bool wanabeeStarOk = true;
-                double meanRadius1 = 0.0;
-                double meanRadius2 = 0.0;
+    const int width = rect.width();
+    std::vector<uint8_t> mask(std::max(width, 0));
 
-                for (size_t k1 = 0; (k1 < 4) && wanabeeStarOk; ++k1)
-                {
-                    for (size_t k2 = 0; (k2 < 4) && wanabeeStarOk; ++k2)
-                    {
-                        if ((k1 != k2) && std::abs(directions[k2].radius - directions[k1].radius) > deltaRadius)
-                            wanabeeStarOk = false;
-                    }
-                }
-                for (size_t k1 = 4; (k1 < 8) && wanabeeStarOk; ++k1)
-                {
-                    for (size_t k2 = 4; (k2 < 8) && wanabeeStarOk; ++k2)
-                    {
-                        if ((k1 != k2) && std::abs(directions[k2].radius - directions[k1].radius) > deltaRadius)
-                            wanabeeStarOk = false;
-                    }
-                }
+    // Find the wanabee stars in the intensity range
+    for (int y = rect.top; y < rect.bottom; ++y)
+    {
+        // First mark the pixels in the intensity range without a neighbour more than 5%
+        // brighter: the other ones are always rejected at the first step of the search
+        // below (since the pixels are above the background). This is done without any
+        // branch, so it can be vectorized by the compiler.
+        const float* above = bitmap->data(rect.left, y - 1);
+        const float* current = bitmap->data(rect.left, y);
+        const float* below = bitmap->data(rect.left, y + 1);
 
-                if (!wanabeeStarOk)
-                    continue;
+        bool found = false;
 
-                // Compute the radiuses of the wannabe star
-                for (size_t k1 = 0; k1 < 4; ++k1)
-                    meanRadius1 += directions[k1].radius;
+        for (int i = 0; i < width; ++i)
+        {
+            const float value = current[i];
 
-                meanRadius1 /= 4.0;
+            float neighbours = std::max(above[i - 1], above[i]);
+            neighbours = std::max(neighbours, above[i + 1]);
+            neighbours = std::max(neighbours, current[i - 1]);
+            neighbours = std::max(neighbours, current[i + 1]);
+            neighbours = std::max(neighbours, below[i - 1]);
+            neighbours = std::max(neighbours, below[i]);
+            neighbours = std::max(neighbours, below[i + 1]);
 
-                for (size_t k1 = 4; k1 < 8; ++k1)
-                    meanRadius2 += directions[k1].radius;
+            mask[i] = (value >= minIntensity) & (value < maxIntensity) &
+                      (neighbours <= 1.05 * value);
 
-                meanRadius2 /= 4.0;
-                meanRadius2 *= sqrt(2.0);
+            found |= mask[i];
+        }
 
-                int leftRadius = 0;
-                int rightRadius = 0;
-                int topRadius = 0;
-                int bottomRadius = 0;
+        if (!found)
+            continue;
 
-                for (const auto &pixel : directions)
-                {
-                    if (pixel.xDir < 0)
-                        leftRadius = std::max(leftRadius, static_cast<int>(pixel.radius));
-                    else if (pixel.xDir > 0)
-                        rightRadius = std::max(rightRadius, static_cast<int>(pixel.radius));
-
-                    if (pixel.yDir < 0)
-                        topRadius = std::max(topRadius, static_cast<int>(pixel.radius));
-                    else if (pixel.yDir > 0)
-                        bottomRadius = std::max(bottomRadius, static_cast<int>(pixel.radius));
-                }
+        for (int x = rect.left; x < rect.right; ++x)
+        {
+            if (!mask[x - rect.left])
+                continue;
+
+            const double intensity = current[x - rect.left];
 
-                // Add the star to the set
-                star_t star(x, y);
-                star.intensity = intensity;
-                star.meanRadius = (meanRadius1 + meanRadius2) / 2.0;
+            // Search around the point until intensity is divided by 2
+            std::array<pixel_direction_t, 8> directions{{{0, -1}, {1, 0}, {0, 1}, {-1, 0}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}}};
 
-                constexpr double radiusFactor = 2.35 / 1.5;
+            bool brighterPixel = false;
+            bool allOk = true;
+            int maxRadius = 0;
+
+            for (int testedRadius = 1; (testedRadius < STARMAXSIZE) && allOk && !brighterPixel; ++testedRadius)
+            {
+                for (auto &pixel : directions)
+                    pixel.intensity = *bitmap->data(x + pixel.xDir * testedRadius, y + pixel.yDir * testedRadius);
 
-                // Compute the real position
-                if (computeStarCenter(bitmap, star.position, star.meanRadius, background))
+                allOk = false;
+                for (auto &pixel : directions)
                 {
-                    // Check last overlap condition
-                    for (star_set_t::const_iterator it = stars.lower_bound(star_t(star.position.x - star.meanRadius * radiusFactor - STARMAXSIZE, 0));
-                         it != stars.cend() && wanabeeStarOk; ++it)
+                    if (pixel.ok)
                     {
-                        if (star.position.distance(it->position) < (star.meanRadius + it->meanRadius) * radiusFactor)
-                            wanabeeStarOk = false;
-                        else if (it->position.x > star.position.x + star.meanRadius * radiusFactor + STARMAXSIZE)
-                            break;
+                        if (pixel.intensity - background < 0.25 * (intensity - background))
+                        {
+                            pixel.radius = testedRadius;
+                            --pixel.ok;
+                            maxRadius = std::max(maxRadius, testedRadius);
+                        }
+                        else if (pixel.intensity > 1.05 * intensity)
+                        {
+                            brighterPixel = true;
+                        }
+                        else if (pixel.intensity > intensity)
+                        {
+                            ++pixel.nbBrighterPixels;
+                        }
                     }
 
-                    if (wanabeeStarOk)
-                    {
-                        star.quality = (10 - deltaRadius) + intensity - star.meanRadius;
-                        stars.insert(std::move(star));
-                        ++nbStars;
-                    }
+                    if (pixel.ok)
+                        allOk = true;
+
+                    if (pixel.nbBrighterPixels > 2)
+                        brighterPixel = true;
+
+                    if (brighterPixel)
+                        break;
                 }
             }
+
+            if (allOk || brighterPixel || (maxRadius <= 2))
+                continue;
+
+            // Check the roundness of the wanabee star
+            // Radiuses should be within deltaRadius pixels of each others (with
+            // deltaRadius < 4)
+            int deltaRadius = 0;
+
+            for (size_t k1 = 0; k1 < 4; ++k1)
+            {
+                for (size_t k2 = 0; k2 < 4; ++k2)
+                    deltaRadius = std::max(deltaRadius, std::abs(directions[k2].radius - directions[k1].radius));
+            }
+            for (size_t k1 = 4; k1 < 8; ++k1)
+            {
+                for (size_t k2 = 4; k2 < 8; ++k2)
+                    deltaRadius = std::max(deltaRadius, std::abs(directions[k2].radius - directions[k1].radius));
+            }
+
+            if (deltaRadius >= 4)
+                continue;
+
+            // Compute the radiuses of the wannabe star
+            double meanRadius1 = 0.0;
+            double meanRadius2 = 0.0;
+
+            for (size_t k1 = 0; k1 < 4; ++k1)
+                meanRadius1 += directions[k1].radius;
+
+            meanRadius1 /= 4.0;
+
+            for (size_t k1 = 4; k1 < 8; ++k1)
+                meanRadius2 += directions[k1].radius;
+
+            meanRadius2 /= 4.0;
+            meanRadius2 *= sqrt(2.0);
+
+            star_t star(x, y);
+            star.intensity = intensity;
+            star.meanRadius = (meanRadius1 + meanRadius2) / 2.0;
+
+            // Compute the real position
+            if (computeStarCenter(bitmap, star.position, star.meanRadius, background))
+                candidates.push_back(candidate_t{ x, y, deltaRadius, star });
+        }
+    }
+
+    // Keep all the candidates sorted by roundness, then in the order of their pixels
+    // (the new ones were found in the order of their pixels)
+    const auto compare = [](const candidate_t& c1, const candidate_t& c2)
+    {
+        if (c1.deltaRadius != c2.deltaRadius)
+            return c1.deltaRadius < c2.deltaRadius;
+
+        return (c1.y < c2.y) || ((c1.y == c2.y) && (c1.x < c2.x));
+    };
+
+    std::stable_sort(candidates.begin() + nbPreviousCandidates, candidates.end(), compare);
+
+    std::inplace_merge(
+        candidates.begin(), candidates.begin() + nbPreviousCandidates, candidates.end(),
+        compare
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+int Registration::registerRect(
+    const candidate_list_t& candidates, double intensityThreshold, star_grid_t& stars
+) const
+{
+    constexpr double radiusFactor = 2.35 / 1.5;
+
+    size_t nbStars = 0;
+
+    // The candidates are sorted by roundness, so the roundest stars are processed first.
+    // Each candidate only needs to be considered once: if it is rejected, the stars
+    // added afterwards can't change that.
+    for (const candidate_t& candidate : candidates)
+    {
+        if (candidate.star.intensity < intensityThreshold)
+            continue;
+
+        // Check that this pixel is not already used in a wanabee star
+        if (stars.contains(candidate.x, candidate.y))
+            continue;
+
+        // Check last overlap condition
+        if (!stars.overlaps(candidate.star, radiusFactor))
+        {
+            star_t star = candidate.star;
+            star.quality = (10 - candidate.deltaRadius) + star.intensity - star.meanRadius;
+            stars.add(star);
+            ++nbStars;
         }
     }
 
@@ -417,8 +480,87 @@ int Registration::registerRect(
 
 //-----------------------------------------------------------------------------
 
+void Registration::star_grid_t::setup(unsigned int width, unsigned int height)
+{
+    nbCellsX = std::max((int(width) + STARMAXSIZE - 1) / STARMAXSIZE, 1);
+    nbCellsY = std::max((int(height) + STARMAXSIZE - 1) / STARMAXSIZE, 1);
+
+    heads.assign(nbCellsX * nbCellsY, -1);
+    next.clear();
+    stars.clear();
+    maxRadius = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+void Registration::star_grid_t::add(const star_t& star)
+{
+    const int x = std::clamp(int(star.position.x) / STARMAXSIZE, 0, nbCellsX - 1);
+    const int y = std::clamp(int(star.position.y) / STARMAXSIZE, 0, nbCellsY - 1);
+
+    int32_t& head = heads[y * nbCellsX + x];
+
+    next.push_back(head);
+    head = int32_t(stars.size());
+
+    stars.push_back(star);
+    maxRadius = std::max(maxRadius, star.meanRadius);
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename PREDICATE>
+bool Registration::star_grid_t::any(
+    const point_t& position, double distance, PREDICATE predicate
+) const
+{
+    const int left = std::max(int(std::floor((position.x - distance) / STARMAXSIZE)), 0);
+    const int right = std::min(int(std::floor((position.x + distance) / STARMAXSIZE)), nbCellsX - 1);
+    const int top = std::max(int(std::floor((position.y - distance) / STARMAXSIZE)), 0);
+    const int bottom = std::min(int(std::floor((position.y + distance) / STARMAXSIZE)), nbCellsY - 1);
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+        {
+            for (int32_t i = heads[y * nbCellsX + x]; i >= 0; i = next[i])
+            {
+                if (predicate(stars[i]))
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool Registration::star_grid_t::contains(int x, int y) const
+{
+    return any(
+        point_t(x, y), maxRadius * (2.35 / 1.5),
+        [x, y](const star_t& star) { return star.contains(x, y); }
+    );
+}
+
+//-----------------------------------------------------------------------------
+
+bool Registration::star_grid_t::overlaps(const star_t& star, double radiusFactor) const
+{
+    return any(
+        star.position, (star.meanRadius + maxRadius) * radiusFactor,
+        [&star, radiusFactor](const star_t& other)
+        {
+            return star.position.distance(other.position) < (star.meanRadius + other.meanRadius) * radiusFactor;
+        }
+    );
+}
+
+//-----------------------------------------------------------------------------
+
 bool Registration::computeStarCenter(
-    const DoubleGrayBitmap *bitmap, point_t& position, double& radius, double background
+    const FloatGrayBitmap *bitmap, point_t& position, double& radius, double background
 ) const
 {
     double sumX = 0.0;
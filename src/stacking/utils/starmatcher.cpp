@@ -14,9 +14,8 @@
 */
 
 #include <astrophoto-toolbox/stacking/utils/starmatcher.h>
+#include <astrophoto-toolbox/stacking/utils/normalequations.h>
 #include <astrophoto-toolbox/algorithms/math.h>
-#include <Eigen/Core>
-#include <Eigen/LU>
 
 using namespace astrophototoolbox;
 using namespace stacking;
@@ -31,27 +30,41 @@ bool StarMatcher::computeTransformation(
 	if ((toStars.size() <= 4) || ((toStars.size() < fromStars.size() / 5) && (toStars.size() < 30)))
         return false;
 
-    this->imageSize = imageSize;
+    return computeTransformation(
+        fromStars, std::make_shared<StarsIndex>(toStars), imageSize, transformation,
+        minDistance
+    );
+}
 
-    star_list_t sortedFromStars = fromStars;
-    star_list_t sortedToStars = toStars;
+//-----------------------------------------------------------------------------
 
-	std::sort(sortedFromStars.begin(), sortedFromStars.end(), star_t::compareIntensity);
-	std::sort(sortedToStars.begin(), sortedToStars.end(), star_t::compareIntensity);
+bool StarMatcher::computeTransformation(
+    const star_list_t& fromStars, const stars_index_ptr_t& toStars,
+    const size2d_t& imageSize, Transformation& transformation, double minDistance,
+    const Transformation* prediction
+)
+{
+    if (!toStars)
+        return false;
 
-    references.clear();
-    targets.clear();
+    if ((toStars->nbStars() <= 4) || ((toStars->nbStars() < fromStars.size() / 5) && (toStars->nbStars() < 30)))
+        return false;
 
-    for (size_t i = 0; i < std::min(sortedToStars.size(), size_t(100)); ++i)
-        references.emplace_back(sortedToStars[i].position);
+    this->imageSize = imageSize;
 
-    for (size_t i = 0; i < std::min(sortedFromStars.size(), size_t(100)); ++i)
-        targets.emplace_back(sortedFromStars[i].position);
+    reference = toStars;
+    targets = StarsIndex::brightestStars(fromStars, reference->maxNbStars());
 
     bool result = false;
 
-    if ((references.size() >= 8) && (targets.size() >= 8))
-        result = computeLargeTriangleTransformation(transformation, minDistance);
+    if ((reference->points().size() >= 8) && (targets.size() >= 8))
+    {
+        if (prediction)
+            result = computePredictedTransformation(*prediction, transformation, minDistance);
+
+        if (!result)
+            result = computeLargeTriangleTransformation(transformation, minDistance);
+    }
 
     return result;
 }
@@ -62,6 +75,11 @@ std::vector<std::tuple<point_t, point_t>> StarMatcher::pairs() const
 {
     std::vector<std::tuple<point_t, point_t>> pairs;
 
+    if (!reference)
+        return pairs;
+
+    const point_list_t& references = reference->points();
+
     for (const auto& pair : votedPairs)
     {
         const auto& ref = references[pair.refStar];
@@ -75,160 +93,190 @@ std::vector<std::tuple<point_t, point_t>> StarMatcher::pairs() const
 
 //-----------------------------------------------------------------------------
 
-bool StarMatcher::computeLargeTriangleTransformation(
-    Transformation& transforms, double minDistance
+bool StarMatcher::computePredictedTransformation(
+    const Transformation& prediction, Transformation& transforms, double minDistance
 )
 {
-    bool result = false;
+    const point_list_t& references = reference->points();
+    const size_t nbPairs = 8;
 
-    referenceIndices.clear();
-    targetIndices.clear();
+    // Pair each target star with the nearest reference star around its predicted
+    // position (each reference star being paired with the nearest target star only)
+    std::vector<int> pairedTargets(references.size(), -1);
+    std::vector<double> pairedDistances(references.size(), MAXPREDICTIONDISTANCE);
 
-    // Compute the distances between the stars
-    computeStarDistances(references, referenceDistances);
-    for (int i = 0; i < referenceDistances.size(); ++i)
-        referenceIndices.push_back(i);
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+        const point_t projected = prediction.transform(targets[i]);
 
-    computeStarDistances(targets, targetDistances);
-    for (int i = 0; i < targetDistances.size(); ++i)
-        targetIndices.push_back(i);
+        int nearest = -1;
+        double nearestDistance = MAXPREDICTIONDISTANCE;
 
-    std::sort(
-        referenceIndices.begin(), referenceIndices.end(),
-        [this](int dist1, int dist2) {
-           return referenceDistances[dist1].distance > referenceDistances[dist2].distance;
+        for (size_t j = 0; j < references.size(); ++j)
+        {
+            const double distance = projected.distance(references[j]);
+            if (distance < nearestDistance)
+            {
+                nearest = static_cast<int>(j);
+                nearestDistance = distance;
+            }
         }
-    );
 
-    std::sort(
-        targetIndices.begin(), targetIndices.end(),
-        [this](int dist1, int dist2) {
-           return targetDistances[dist1].distance > targetDistances[dist2].distance;
-        }
-    );
+        if ((nearest < 0) || (nearestDistance >= pairedDistances[nearest]))
+            continue;
 
-    // Pair stars from both images
-    voting_pair_list_t votingPairs;
+        // If a minimum distance was specified, ignore the stars that didn't moved at
+        // least that much
+        if ((minDistance > 0.0) && (references[nearest].distance(targets[i]) < minDistance))
+            continue;
 
-    initVotingGrid(votingPairs);
+        pairedTargets[nearest] = static_cast<int>(i);
+        pairedDistances[nearest] = nearestDistance;
+    }
 
-    auto addVote = [](uint8_t refStar, uint8_t targetStar, voting_pair_list_t& votingPairs, size_t nbTargetStars)
-    {
-        int offset = refStar * nbTargetStars + targetStar;
-        votingPairs[offset].nbVotes++;
-    };
+    voting_pair_list_t pairs;
+    NormalEquations equations(imageSize.width, imageSize.height);
 
-    int i = 0;
-    int j = 0;
-    while ((i < targetDistances.size()) && (j < referenceDistances.size()))
+    for (size_t i = 0; i < references.size(); ++i)
     {
-        if (fabs(targetDistances[targetIndices[i]].distance - referenceDistances[referenceIndices[j]].distance) <= MAXSTARDISTANCEDELTA)
+        if (pairedTargets[i] >= 0)
         {
-            // These are within 2 pixels ... find all the others stars using the same stars
-            // in the targets list and check if the distances are the same in the reference.
-            // If it is the case, cast a vote for each potential pair.
-            float refDistance12 = referenceDistances[referenceIndices[j]].distance;
-            float targetDistance12 = targetDistances[targetIndices[i]].distance;
+            pairs.push_back(VotingPair(i, pairedTargets[i]));
+            equations.add(targets[pairedTargets[i]], references[i]);
+        }
+    }
+
+    // Fit the transformation, removing the worst pair until all the stars are near
+    // enough to their projection
+    Transformation transformation;
 
-            int refStar1 = referenceDistances[referenceIndices[j]].star1;
-            int refStar2 = referenceDistances[referenceIndices[j]].star2;
+    while (pairs.size() >= nbPairs)
+    {
+        if (!equations.solve(transformation))
+            return false;
+
+        double maxDistance = 0.0;
+        size_t maxDistanceIndex = 0;
 
-            int targetStar1 = targetDistances[targetIndices[i]].star1;
-            int targetStar2 = targetDistances[targetIndices[i]].star2;
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            const point_t projected = transformation.transform(targets[pairs[i].targetStar]);
+            const double distance = projected.distance(references[pairs[i].refStar]);
 
-            for (int targetStar3 = 0; targetStar3 < targets.size(); ++targetStar3)
+            if (distance > maxDistance)
             {
-                if ((targetStar3 == targetStar1) || (targetStar3 == targetStar2))
-                    continue;
+                maxDistance = distance;
+                maxDistanceIndex = i;
+            }
+        }
 
-                stars_distance_list_t::iterator it;
-                double targetDistance13 = 0.0;
-                double targetDistance23 = 0.0;
-                double ratio;
+        if (maxDistance <= StarsIndex::MAXDISTANCEDELTA)
+        {
+            transforms = transformation;
+            votedPairs = pairs;
+            return true;
+        }
 
-                it = std::lower_bound(targetDistances.begin(), targetDistances.end(), StarsDistance(targetStar1, targetStar3));
-                if (it != targetDistances.end())
-                    targetDistance13 = (*it).distance;
+        const VotingPair& pair = pairs[maxDistanceIndex];
+        equations.remove(targets[pair.targetStar], references[pair.refStar]);
+        pairs.erase(pairs.begin() + maxDistanceIndex);
+    }
 
-                it = std::lower_bound(targetDistances.begin(), targetDistances.end(), StarsDistance(targetStar2, targetStar3));
-                if (it != targetDistances.end())
-                    targetDistance23 = (*it).distance;
+    return false;
+}
 
-                ratio = std::max(targetDistance13, targetDistance23) / targetDistance12;
+//-----------------------------------------------------------------------------
 
-                // 0.9 avoids many useless triangles with two big sides and one small side
-                if (ratio < 0.9)
-                {
-                    // Search a star from reference such as
-                    //   - distance from 1 to 3 is near targetDistance13
-                    //   - distance from 2 to 3 is near targetDistance23
-                    for (int refStar3 = 0; refStar3 < references.size(); ++refStar3)
-                    {
-                        if ((refStar3 == refStar1) || (refStar3 == refStar2))
-                            continue;
+bool StarMatcher::computeLargeTriangleTransformation(
+    Transformation& transforms, double minDistance
+)
+{
+    bool result = false;
 
-                        double refDistance13 = 0.0;
-                        double refDistance23 = 0.0;
+    const point_list_t& references = reference->points();
 
-                        it = std::lower_bound(referenceDistances.begin(), referenceDistances.end(), StarsDistance(refStar1, refStar3));
-                        if (it != referenceDistances.end())
-                            refDistance13 = (*it).distance;
+    // Compute the distances between the target stars
+    const size_t nbTargets = targets.size();
+    std::vector<float> targetDistances(nbTargets * nbTargets);
 
-                        it = std::lower_bound(referenceDistances.begin(), referenceDistances.end(), StarsDistance(refStar2, refStar3));
-                        if (it != referenceDistances.end())
-                            refDistance23 = (*it).distance;
+    for (size_t i = 0; i < nbTargets; ++i)
+    {
+        for (size_t j = i + 1; j < nbTargets; ++j)
+        {
+            targetDistances[i * nbTargets + j] = targets[i].distance(targets[j]);
+            targetDistances[j * nbTargets + i] = targetDistances[i * nbTargets + j];
+        }
+    }
 
-                        if ((fabs(refDistance13 - targetDistance13) < MAXSTARDISTANCEDELTA) &&
-                            (fabs(refDistance23 - targetDistance23) < MAXSTARDISTANCEDELTA))
+    // Pair stars from both images: for each triangle of target stars, retrieve the
+    // triangles of reference stars with the same sides (within 2 pixels) and cast a
+    // vote for each potential pair
+    std::vector<unsigned int> votes(references.size() * nbTargets, 0);
+
+    auto addVote = [&votes, nbTargets](uint16_t refStar, uint16_t targetStar)
+    {
+        votes[refStar * nbTargets + targetStar]++;
+    };
+
+    for (size_t i = 0; i < nbTargets; ++i)
+    {
+        for (size_t j = i + 1; j < nbTargets; ++j)
+        {
+            for (size_t k = j + 1; k < nbTargets; ++k)
+            {
+                triangle_t triangle(
+                    i, j, k, targetDistances[i * nbTargets + j],
+                    targetDistances[i * nbTargets + k], targetDistances[j * nbTargets + k]
+                );
+
+                if (!StarsIndex::isUsable(triangle))
+                    continue;
+
+                reference->findSimilarTriangles(
+                    triangle,
+                    [&triangle, &addVote](const triangle_t& refTriangle, bool swapped)
+                    {
+                        if (!swapped)
                         {
-                            // Cast votes for stars
-                            addVote(refStar1, targetStar1, votingPairs, (int) targets.size());
-                            addVote(refStar2, targetStar2, votingPairs, (int) targets.size());
-                            addVote(refStar3, targetStar3, votingPairs, (int) targets.size());
+                            addVote(refTriangle.star1, triangle.star1);
+                            addVote(refTriangle.star2, triangle.star2);
                         }
-                        else if ((fabs(refDistance23 - targetDistance13) < MAXSTARDISTANCEDELTA) &&
-                                 (fabs(refDistance13 - targetDistance23) < MAXSTARDISTANCEDELTA))
+                        else
                         {
-                            // Cast votes for stars
-                            addVote(refStar1, targetStar2, votingPairs, (int) targets.size());
-                            addVote(refStar2, targetStar1, votingPairs, (int) targets.size());
-                            addVote(refStar3, targetStar3, votingPairs, (int) targets.size());
+                            addVote(refTriangle.star1, triangle.star2);
+                            addVote(refTriangle.star2, triangle.star1);
                         }
+
+                        addVote(refTriangle.star3, triangle.star3);
                     }
-                }
+                );
             }
         }
-
-        if (targetDistances[targetIndices[i]].distance < referenceDistances[referenceIndices[j]].distance)
-            j++;
-        else
-            i++;
     }
 
-    // If a minimum distance was specified, nullify the pairs that didn't moved at least that much
-    if (minDistance > 0.0)
+    // Only keep the pairs that received votes. If a minimum distance was specified,
+    // discard the pairs that didn't moved at least that much.
+    voting_pair_list_t votingPairs;
+
+    for (size_t i = 0; i < references.size(); ++i)
     {
-        for (auto& pair : votingPairs)
+        for (size_t j = 0; j < nbTargets; ++j)
         {
-            if ((pair.nbVotes > 0) && (references[pair.refStar].distance(targets[pair.targetStar]) < minDistance))
-            {
-                pair.nbVotes = 0;
-                pair.setActive(false);
+            const unsigned int nbVotes = votes[i * nbTargets + j];
+            if (nbVotes == 0)
+                continue;
 
-                for (auto& pair2 : votingPairs)
-                {
-                    if ((pair2.refStar == pair.refStar) || (pair2.targetStar == pair.targetStar))
-                    {
-                        pair.nbVotes = 0;
-                        pair.setActive(false);
-                    }
-                }
-            }
+            if ((minDistance > 0.0) && (references[i].distance(targets[j]) < minDistance))
+                continue;
+
+            VotingPair pair(i, j);
+            pair.nbVotes = nbVotes;
+            votingPairs.push_back(pair);
         }
     }
 
     // Sort voting pairs in descending order
-    std::sort(
+    std::stable_sort(
         votingPairs.begin(), votingPairs.end(),
         [](const VotingPair& a, const VotingPair& b) { return a.nbVotes > b.nbVotes; }
     );
@@ -236,15 +284,16 @@ bool StarMatcher::computeLargeTriangleTransformation(
     // Eliminate false matches and get transformations parameters
     if (!votingPairs.empty())
     {
-        int minNbVotes;
-        int cut = 0;
+        unsigned int minNbVotes = 1;
+        size_t cut = 0;
 
-        minNbVotes = std::max(votingPairs[targets.size() * 2 - 1].nbVotes, (unsigned) 1);
+        if (votingPairs.size() >= nbTargets * 2)
+            minNbVotes = std::max(votingPairs[nbTargets * 2 - 1].nbVotes, minNbVotes);
 
-        while (votingPairs[cut].nbVotes >= minNbVotes)
+        while ((cut < votingPairs.size()) && (votingPairs[cut].nbVotes >= minNbVotes))
             ++cut;
 
-        votingPairs.resize(cut+1);
+        votingPairs.resize(std::min(cut + 1, votingPairs.size()));
 
         result = computeSigmaClippingTransformation(votingPairs, transforms);
     }
@@ -254,42 +303,6 @@ bool StarMatcher::computeLargeTriangleTransformation(
 
 //-----------------------------------------------------------------------------
 
-void StarMatcher::computeStarDistances(const point_list_t& stars, stars_distance_list_t& distances)
-{
-    double maxDistance = 0;
-
-    distances.clear();
-    distances.reserve(stars.size() * (stars.size() - 1) / 2);
-
-    for (int i = 0; i < stars.size(); ++i)
-    {
-        for (int j = i + 1; j < stars.size(); ++j)
-        {
-            double distance = stars[i].distance(stars[j]);
-            maxDistance = std::max(distance, maxDistance);
-            distances.emplace_back(i, j, distance);
-        };
-    };
-
-    std::sort(distances.begin(), distances.end());
-}
-
-//-----------------------------------------------------------------------------
-
-void StarMatcher::initVotingGrid(voting_pair_list_t& votingPairs)
-{
-    votingPairs.clear();
-    votingPairs.reserve(references.size() * targets.size());
-
-    for (int i = 0; i < references.size(); ++i)
-    {
-        for (int j = 0; j < targets.size(); ++j)
-            votingPairs.push_back(VotingPair(i, j));
-    }
-}
-
-//-----------------------------------------------------------------------------
-
 bool StarMatcher::computeSigmaClippingTransformation(
     const voting_pair_list_t& votingPairs, Transformation& transforms
 )
@@ -324,15 +337,22 @@ bool StarMatcher::computeCoordinatesTransformation(
     bool result = false;
     voting_pair_list_t pairs;
 
+    const point_list_t& references = reference->points();
+
     const size_t nbPairs = 8;
     std::vector<int> addedPairs;
     voting_pair_list_t testedPairs;
     voting_pair_list_t goodPairs;
     std::vector<int> goodAddedPairs;
     Transformation goodTransformation;
+    std::vector<double> distances;
 
     pairs = votingPairs;
 
+    addedPairs.reserve(nbPairs);
+    testedPairs.reserve(pairs.size());
+    distances.reserve(nbPairs);
+
     while (!result)
     {
         addedPairs.clear();
@@ -357,11 +377,11 @@ bool StarMatcher::computeCoordinatesTransformation(
 
         if (computeTransformation(testedPairs, transformation))
         {
-            std::vector<double> distances;
             double maxDistance = 0.0;
             size_t maxDistanceIndex = 0;
 
             // Compute the distance between the stars and their projection
+            distances.clear();
             for (size_t i = 0; i < testedPairs.size(); i++)
             {
                 const point_t projected = transformation.transform(targets[testedPairs[i].targetStar]);
@@ -432,31 +452,32 @@ bool StarMatcher::computeCoordinatesTransformation(
     if (goodPairs.empty())
         return false;
 
-    // Try to add other pairs to refine the transformation
+    // Try to add other pairs to refine the transformation, updating the least squares
+    // fit one pair at a time
+    NormalEquations equations(imageSize.width, imageSize.height);
     Transformation transformation = goodTransformation;
     transforms = goodTransformation;
-    voting_pair_list_t tempPairs;
     int nbFails = 0;
 
     testedPairs = goodPairs;
-    addedPairs = goodAddedPairs;
 
-    for (size_t index : addedPairs)
+    for (const auto& pair : testedPairs)
+        equations.add(targets[pair.targetStar], references[pair.refStar]);
+
+    for (size_t index : goodAddedPairs)
         votingPairs[index].setUsed(true);
 
     while (true)
     {
-        double maxDistance;
         bool transformOk = false;
         int addedPair = -1;
 
-        tempPairs = testedPairs;
         for (size_t i = 0; (i < votingPairs.size()) && (addedPair < 0); ++i)
         {
             if (votingPairs[i].isActive() && !votingPairs[i].isUsed())
             {
                 addedPair = static_cast<int>(i);
-                tempPairs.push_back(votingPairs[i]);
+                testedPairs.push_back(votingPairs[i]);
                 votingPairs[addedPair].setUsed(true);
             }
         }
@@ -464,14 +485,15 @@ bool StarMatcher::computeCoordinatesTransformation(
         if (addedPair < 0)
             break;
 
-        if (computeTransformation(tempPairs, transformation))
+        const VotingPair& pair = testedPairs.back();
+        equations.add(targets[pair.targetStar], references[pair.refStar]);
+
+        if (equations.solve(transformation))
         {
-            maxDistance = validateTransformation(tempPairs, transformation);
+            double maxDistance = validateTransformation(testedPairs, transformation);
             if (maxDistance <= 2)
             {
-                testedPairs = tempPairs;
                 transforms = transformation;
-                addedPairs.push_back(addedPair);
                 transformOk = true;
             }
             else
@@ -480,6 +502,9 @@ bool StarMatcher::computeCoordinatesTransformation(
 
         if (!transformOk)
         {
+            equations.remove(targets[pair.targetStar], references[pair.refStar]);
+            testedPairs.pop_back();
+
             ++nbFails;
             if (nbFails > 3)
                 break;
@@ -497,52 +522,14 @@ bool StarMatcher::computeTransformation(
     const voting_pair_list_t & votingPairs, Transformation& transforms
 )
 {
-    transforms.xWidth = imageSize.width;
-    transforms.yWidth = imageSize.height;
-
-    Eigen::MatrixXd M(votingPairs.size(), 4);
-    Eigen::MatrixXd X(votingPairs.size(), 1);
-    Eigen::MatrixXd Y(votingPairs.size(), 1);
-
-    for (int i = 0; i < votingPairs.size(); ++i)
-    {
-        point_t& star = references[votingPairs[i].refStar];
-        X(i, 0) = star.x / transforms.xWidth;
-        Y(i, 0) = star.y / transforms.yWidth;
-    }
-
-    for (int i = 0; i < votingPairs.size(); ++i)
-    {
-        point_t& star = targets[votingPairs[i].targetStar];
-        double X = star.x / transforms.xWidth;
-        double Y = star.y / transforms.yWidth;
-
-        M(i, 0) = 1.0;
-        M(i, 1) = X;
-        M(i, 2) = Y;
-        M(i, 3) = X * Y;
-    };
+    const point_list_t& references = reference->points();
 
-    Eigen::MatrixXd MT = M.transpose();
-    Eigen::MatrixXd TM = MT * M;
-
-    Eigen::FullPivLU<Eigen::MatrixXd> lu(TM);
-    if (!lu.isInvertible())
-        return false;
+    NormalEquations equations(imageSize.width, imageSize.height);
 
-    Eigen::MatrixXd A = TM.inverse() * MT * X;
-    Eigen::MatrixXd B = TM.inverse() * MT * Y;
+    for (const auto& pair : votingPairs)
+        equations.add(targets[pair.targetStar], references[pair.refStar]);
 
-    transforms.a0 = A(0, 0);
-    transforms.a1 = A(1, 0);
-    transforms.a2 = A(2, 0);
-    transforms.a3 = A(3, 0);
-    transforms.b0 = B(0, 0);
-    transforms.b1 = B(1, 0);
-    transforms.b2 = B(2, 0);
-    transforms.b3 = B(3, 0);
-
-    return true;
+    return equations.solve(transforms);
 }
 
 //-----------------------------------------------------------------------------
@@ -553,6 +540,8 @@ double StarMatcher::validateTransformation(
 {
 	double result = 0.0;
 
+    const point_list_t& references = reference->points();
+
 	// Compute the distance between the stars
 	for (const auto& testedPair : testedPairs)
 	{
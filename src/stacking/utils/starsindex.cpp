@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <astrophoto-toolbox/stacking/utils/starsindex.h>
+
+using namespace astrophototoolbox;
+using namespace stacking;
+using namespace utils;
+
+
+triangle_t::triangle_t(
+    uint16_t star1, uint16_t star2, uint16_t star3, float distance12, float distance13,
+    float distance23
+)
+{
+    // Find the longest side
+    if ((distance13 > distance12) && (distance13 >= distance23))
+    {
+        std::swap(star2, star3);
+        std::swap(distance12, distance13);
+    }
+    else if ((distance23 > distance12) && (distance23 > distance13))
+    {
+        std::swap(star1, star3);
+        std::swap(distance12, distance23);
+    }
+
+    // Order the two other sides
+    if (distance23 > distance13)
+    {
+        std::swap(star1, star2);
+        std::swap(distance13, distance23);
+    }
+
+    this->star1 = star1;
+    this->star2 = star2;
+    this->star3 = star3;
+
+    a = distance12;
+    b = distance13;
+    c = distance23;
+}
+
+//-----------------------------------------------------------------------------
+
+StarsIndex::StarsIndex(const star_list_t& stars, size_t maxNbStars)
+: nbTotalStars(stars.size()), maxNbIndexedStars(maxNbStars)
+{
+    positions = brightestStars(stars, maxNbStars);
+
+    const size_t nb = positions.size();
+
+    // Compute the distances between the stars
+    std::vector<float> distances(nb * nb);
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+        for (size_t j = i + 1; j < nb; ++j)
+        {
+            distances[i * nb + j] = positions[i].distance(positions[j]);
+            distances[j * nb + i] = distances[i * nb + j];
+        }
+    }
+
+    // Retrieve the triangles that might be similar to a usable one
+    std::vector<uint32_t> cells;
+
+    for (size_t i = 0; i < nb; ++i)
+    {
+        for (size_t j = i + 1; j < nb; ++j)
+        {
+            for (size_t k = j + 1; k < nb; ++k)
+            {
+                triangle_t triangle(
+                    i, j, k, distances[i * nb + j], distances[i * nb + k],
+                    distances[j * nb + k]
+                );
+
+                if (triangle.b >= MAXRATIO * (triangle.a + MAXDISTANCEDELTA) + MAXDISTANCEDELTA)
+                    continue;
+
+                triangles.push_back(triangle);
+                cells.push_back(cell(triangle.b / triangle.a) * GRIDSIZE + cell(triangle.c / triangle.a));
+            }
+        }
+    }
+
+    // Sort them by cell of the grid
+    offsets.resize(GRIDSIZE * GRIDSIZE + 1, 0);
+
+    for (uint32_t cell : cells)
+        ++offsets[cell + 1];
+
+    for (size_t i = 1; i < offsets.size(); ++i)
+        offsets[i] += offsets[i - 1];
+
+    std::vector<triangle_t> sortedTriangles(triangles.size());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+
+    for (size_t i = 0; i < triangles.size(); ++i)
+        sortedTriangles[next[cells[i]]++] = triangles[i];
+
+    triangles = std::move(sortedTriangles);
+}
+
+//-----------------------------------------------------------------------------
+
+point_list_t StarsIndex::brightestStars(const star_list_t& stars, size_t maxNbStars)
+{
+    star_list_t sortedStars = stars;
+    std::sort(sortedStars.begin(), sortedStars.end(), star_t::compareIntensity);
+
+    point_list_t positions;
+    positions.reserve(std::min(sortedStars.size(), maxNbStars));
+
+    for (size_t i = 0; i < std::min(sortedStars.size(), maxNbStars); ++i)
+        positions.emplace_back(sortedStars[i].position);
+
+    return positions;
+}
@@ -32,3 +32,42 @@ TEST_CASE("Interpolation (reduced range)", "[Interpolation]")
     REQUIRE(interpolation.interpolate(240.0) == Approx(230.0));
     REQUIRE(interpolation.interpolate(255.0) == Approx(230.0));
 }
+
+
+TEST_CASE("Interpolation of an array of values", "[Interpolation]")
+{
+    Interpolation interpolation(10, 100, 240, 20, 150, 230);
+
+    std::vector<double> values(256);
+    std::vector<uint16_t> integers(2 * 256);
+    for (unsigned int i = 0; i < 256; ++i)
+    {
+        values[i] = i + 0.5;
+        integers[2 * i] = i;
+        integers[2 * i + 1] = 1000;
+    }
+
+    interpolation.interpolate(values.data(), values.size());
+    interpolation.interpolate(integers.data(), 256, 2);
+
+    for (unsigned int i = 0; i < 256; ++i)
+    {
+        REQUIRE(values[i] == interpolation.interpolate(i + 0.5));
+        REQUIRE(integers[2 * i] == uint16_t(interpolation.interpolate(i)));
+        REQUIRE(integers[2 * i + 1] == 1000);
+    }
+}
+
+
+TEST_CASE("Interpolation of an array of values (no scaling)", "[Interpolation]")
+{
+    Interpolation interpolation(0, 0, 0, 5, 5, 5);
+
+    const std::vector<float> originals = { 0.0f, 2.0f, 10.0f };
+    std::vector<float> values = originals;
+
+    interpolation.interpolate(values.data(), values.size());
+
+    for (unsigned int i = 0; i < values.size(); ++i)
+        REQUIRE(values[i] == float(interpolation.interpolate(originals[i])));
+}
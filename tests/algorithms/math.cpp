@@ -56,3 +56,77 @@ TEST_CASE("Median computation", "[Math]")
         REQUIRE(median == 4);
     }
 }
+
+
+TEST_CASE("Median selection", "[Math]")
+{
+    SECTION("with an odd number of values")
+    {
+        std::vector<uint16_t> data { 10, 20, 0, 5, 10, 20, 10, 5, 5, 5, 0, 0, 0, 5, 7 };
+        REQUIRE(selectMedian(data) == 5);
+    }
+
+    SECTION("with an even number of values")
+    {
+        std::vector<uint16_t> data { 10, 20, 0, 5, 10, 20, 10, 5, 5, 5, 0, 0, 0, 5 };
+        REQUIRE(selectMedian(data) == 5);
+    }
+
+    SECTION("with few values")
+    {
+        std::vector<double> data1 { 0.25 };
+        REQUIRE(selectMedian(data1) == 0.25);
+
+        std::vector<double> data2 { 0.75, 0.25 };
+        REQUIRE(selectMedian(data2) == 0.25);
+
+        std::vector<double> data3 { 0.75, 0.125, 0.25 };
+        REQUIRE(selectMedian(data3) == 0.25);
+    }
+
+    SECTION("with many values")
+    {
+        std::vector<uint32_t> data;
+        for (uint32_t i = 0; i < 101; ++i)
+            data.push_back(((i * 37) % 101) * 100000);
+
+        REQUIRE(selectMedian(data) == 5000000);
+    }
+
+    SECTION("without values")
+    {
+        std::vector<float> data;
+        REQUIRE(selectMedian(data) == 0.0f);
+    }
+}
+
+
+TEST_CASE("Kappa-sigma clipped average computation", "[Math]")
+{
+    std::vector<uint16_t> data { 
+        100, 102, 98, 101, 99, 100, 103, 97, 100, 5000
+    };
+
+    SECTION("without clipping")
+    {
+        double average = computeKappaSigmaClippedAverage(data.data(), data.size(), 2.0, 1);
+        REQUIRE(average == Approx(590.0));
+    }
+
+    SECTION("with clipping")
+    {
+        double average = computeKappaSigmaClippedAverage(data.data(), data.size(), 2.0, 5);
+        REQUIRE(average == Approx(100.0));
+    }
+}
+
+
+TEST_CASE("Winsorized sigma clipped average computation", "[Math]")
+{
+    std::vector<uint16_t> data { 
+        100, 102, 98, 101, 99, 100, 103, 97, 100, 5000
+    };
+
+    double average = computeWinsorizedSigmaClippedAverage(data.data(), data.size(), 3.0, 10);
+    REQUIRE(average == Approx(100.0));
+}
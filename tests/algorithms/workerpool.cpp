@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <catch.hpp>
+#include <astrophoto-toolbox/algorithms/workerpool.h>
+#include <atomic>
+#include <set>
+
+using namespace astrophototoolbox;
+
+
+TEST_CASE("Running tasks with a pool of workers", "[WorkerPool]")
+{
+    WorkerPool workers(4);
+    REQUIRE(workers.nbThreads() == 4);
+
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    std::atomic<unsigned int> nbCalls = 0;
+
+    auto task = [&]()
+    {
+        ++nbCalls;
+
+        std::lock_guard lock(mutex);
+        ids.insert(std::this_thread::get_id());
+    };
+
+    SECTION("with all the threads")
+    {
+        workers.run(task);
+
+        REQUIRE(nbCalls == 4);
+        REQUIRE(ids.size() == 4);
+        REQUIRE(ids.count(std::this_thread::get_id()) == 1);
+    }
+
+    SECTION("with some of the threads")
+    {
+        workers.run(task, 2);
+
+        REQUIRE(nbCalls == 2);
+        REQUIRE(ids.size() == 2);
+        REQUIRE(ids.count(std::this_thread::get_id()) == 1);
+    }
+
+    SECTION("with only the calling thread")
+    {
+        workers.run(task, 1);
+
+        REQUIRE(nbCalls == 1);
+        REQUIRE(ids.size() == 1);
+        REQUIRE(ids.count(std::this_thread::get_id()) == 1);
+    }
+
+    SECTION("the threads are reused by the next tasks")
+    {
+        workers.run(task);
+        const std::set<std::thread::id> firstIds = ids;
+
+        for (int i = 0; i < 100; ++i)
+        {
+            ids.clear();
+            workers.run(task, (i % 4) + 1);
+
+            for (const auto& id : ids)
+                REQUIRE(firstIds.count(id) == 1);
+        }
+
+        REQUIRE(nbCalls == 4 + 25 * (1 + 2 + 3 + 4));
+    }
+}
+
+
+TEST_CASE("Sharing work between the threads of a pool", "[WorkerPool]")
+{
+    const int NB_ITEMS = 1000;
+
+    WorkerPool workers(3);
+
+    std::vector<int> items(NB_ITEMS, 0);
+
+    for (int k = 1; k <= 10; ++k)
+    {
+        std::atomic<int> nextItem = 0;
+
+        workers.run([&]()
+        {
+            for (int i = nextItem++; i < NB_ITEMS; i = nextItem++)
+                items[i] += k;
+        });
+    }
+
+    for (int i = 0; i < NB_ITEMS; ++i)
+        REQUIRE(items[i] == 55);
+}
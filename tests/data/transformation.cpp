@@ -0,0 +1,561 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <catch.hpp>
+#include <astrophoto-toolbox/data/transformation.h>
+#include <astrophoto-toolbox/images/bitmap.h>
+
+using namespace astrophototoolbox;
+
+
+TEST_CASE("Identity transformation of a bitmap", "[Transformation]")
+{
+    const unsigned int WIDTH = 20;
+    const unsigned int HEIGHT = 10;
+
+    UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        *(bitmap.data() + i) = (i * 37) % 1000 + 1;
+
+    interpolation_t interpolation;
+
+    SECTION("bilinear")
+    {
+        interpolation = INTERPOLATION_BILINEAR;
+    }
+
+    SECTION("bicubic")
+    {
+        interpolation = INTERPOLATION_BICUBIC;
+    }
+
+    SECTION("lanczos")
+    {
+        interpolation = INTERPOLATION_LANCZOS3;
+    }
+
+    Transformation transformation;
+
+    UInt16ColorBitmap* transformed = transformation.transform(&bitmap, interpolation);
+
+    REQUIRE(transformed);
+    REQUIRE(transformed->width() == WIDTH);
+    REQUIRE(transformed->height() == HEIGHT);
+    REQUIRE(transformed->range() == bitmap.range());
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        REQUIRE(*(transformed->data() + i) == *(bitmap.data() + i));
+
+    delete transformed;
+}
+
+
+TEST_CASE("Shift of a bitmap", "[Transformation]")
+{
+    const unsigned int WIDTH = 20;
+    const unsigned int HEIGHT = 10;
+
+    FloatGrayBitmap bitmap(WIDTH, HEIGHT);
+
+    for (unsigned int y = 0; y < HEIGHT; ++y)
+    {
+        for (unsigned int x = 0; x < WIDTH; ++x)
+            *bitmap.data(x, y) = 0.1f + 0.01f * x + 0.02f * y;
+    }
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+
+    SECTION("by an integer amount")
+    {
+        transformation.a0 = 3.0 / WIDTH;
+        transformation.b0 = 2.0 / HEIGHT;
+
+        FloatGrayBitmap* transformed = transformation.transform(&bitmap);
+
+        for (unsigned int y = 0; y < HEIGHT; ++y)
+        {
+            for (unsigned int x = 0; x < WIDTH; ++x)
+            {
+                if ((x >= 3) && (y >= 2))
+                    REQUIRE(*transformed->data(x, y) == Approx(*bitmap.data(x - 3, y - 2)));
+                else
+                    REQUIRE(*transformed->data(x, y) == 0.0f);
+            }
+        }
+
+        delete transformed;
+    }
+
+    SECTION("by half a pixel")
+    {
+        transformation.a0 = 0.5 / WIDTH;
+
+        FloatGrayBitmap* transformed = transformation.transform(&bitmap);
+
+        for (unsigned int y = 0; y < HEIGHT; ++y)
+        {
+            REQUIRE(*transformed->data(0, y) == 0.0f);
+
+            for (unsigned int x = 1; x < WIDTH; ++x)
+                REQUIRE(*transformed->data(x, y) == Approx(0.1f + 0.01f * (x - 0.5f) + 0.02f * y));
+        }
+
+        delete transformed;
+    }
+}
+
+
+TEST_CASE("Inverse mapping of the pixels", "[Transformation]")
+{
+    const unsigned int WIDTH = 40;
+    const unsigned int HEIGHT = 30;
+
+    // Each pixel contains its own coordinates, so the source location of each pixel of
+    // the transformed bitmap can be retrieved
+    DoubleColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (unsigned int y = 0; y < HEIGHT; ++y)
+    {
+        for (unsigned int x = 0; x < WIDTH; ++x)
+        {
+            double* pixel = bitmap.data(x, y);
+            pixel[0] = x;
+            pixel[1] = y;
+            pixel[2] = 1.0;
+        }
+    }
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+
+    SECTION("rotation")
+    {
+        const double angle = 0.1;
+        transformation.a0 = 0.1;
+        transformation.a1 = cos(angle);
+        transformation.a2 = -sin(angle) * HEIGHT / WIDTH;
+        transformation.b0 = -0.05;
+        transformation.b1 = sin(angle) * WIDTH / HEIGHT;
+        transformation.b2 = cos(angle);
+    }
+
+    SECTION("bilinear transformation")
+    {
+        transformation.a0 = 0.05;
+        transformation.a1 = 0.98;
+        transformation.a2 = 0.02;
+        transformation.a3 = 0.03;
+        transformation.b0 = -0.02;
+        transformation.b1 = 0.01;
+        transformation.b2 = 1.01;
+        transformation.b3 = -0.04;
+    }
+
+    DoubleColorBitmap* transformed = transformation.transform(&bitmap);
+
+    unsigned int nbValidPixels = 0;
+
+    for (unsigned int y = 0; y < HEIGHT; ++y)
+    {
+        for (unsigned int x = 0; x < WIDTH; ++x)
+        {
+            double* pixel = transformed->data(x, y);
+            if (pixel[2] == 0.0)
+                continue;
+
+            REQUIRE(pixel[2] == Approx(1.0));
+
+            point_t p = transformation.transform(point_t(pixel[0], pixel[1]));
+            REQUIRE(p.x == Approx(x).margin(1e-6));
+            REQUIRE(p.y == Approx(y).margin(1e-6));
+
+            ++nbValidPixels;
+        }
+    }
+
+    REQUIRE(nbValidPixels > WIDTH * HEIGHT / 2);
+
+    delete transformed;
+}
+
+
+TEST_CASE("Transformation with several threads", "[Transformation]")
+{
+    const unsigned int WIDTH = 50;
+    const unsigned int HEIGHT = 40;
+
+    UInt8ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        *(bitmap.data() + i) = (i * 13) % 251;
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+    transformation.a0 = 0.013;
+    transformation.a1 = 0.995;
+    transformation.a2 = 0.07;
+    transformation.b0 = 0.021;
+    transformation.b1 = -0.05;
+    transformation.b2 = 0.998;
+
+    UInt8ColorBitmap* reference = transformation.transform(&bitmap, INTERPOLATION_LANCZOS3, 1);
+    UInt8ColorBitmap* transformed = transformation.transform(&bitmap, INTERPOLATION_LANCZOS3, 4);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        REQUIRE(*(transformed->data() + i) == *(reference->data() + i));
+
+    delete reference;
+    delete transformed;
+}
+
+
+TEST_CASE("Classification of transformations", "[Transformation]")
+{
+    const size2d_t size(400, 300);
+
+    Transformation transformation;
+    transformation.xWidth = size.width;
+    transformation.yWidth = size.height;
+
+    SECTION("identity")
+    {
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_IDENTITY);
+
+        transformation.a1 = 1.00001;
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_IDENTITY);
+    }
+
+    SECTION("integer shift")
+    {
+        transformation.a0 = 3.0 / size.width;
+        transformation.b0 = -2.0 / size.height;
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_INTEGER_SHIFT);
+    }
+
+    SECTION("subpixel shift")
+    {
+        transformation.a0 = 3.4 / size.width;
+        transformation.b0 = -2.0 / size.height;
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_SUBPIXEL_SHIFT);
+    }
+
+    SECTION("rigid")
+    {
+        const double angle = 0.01;
+        transformation.a0 = 3.4 / size.width;
+        transformation.a1 = cos(angle);
+        transformation.a2 = -sin(angle) * size.height / size.width;
+        transformation.b1 = sin(angle) * size.width / size.height;
+        transformation.b2 = cos(angle);
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_RIGID);
+    }
+
+    SECTION("scaling")
+    {
+        transformation.a1 = 1.01;
+        transformation.b2 = 1.01;
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_GENERIC);
+    }
+
+    SECTION("bilinear")
+    {
+        transformation.a3 = 0.001;
+        REQUIRE(transformation.classify(size) == TRANSFORMATION_GENERIC);
+        REQUIRE(transformation.classify(size, 1.0) == TRANSFORMATION_IDENTITY);
+    }
+}
+
+
+TEST_CASE("Fast path of the transformation of a bitmap (integer shift)", "[Transformation]")
+{
+    const int WIDTH = 50;
+    const int HEIGHT = 40;
+
+    UInt8ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        *(bitmap.data() + i) = (i * 13) % 251;
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+    transformation.a0 = -4.0 / WIDTH;
+    transformation.b0 = 7.0 / HEIGHT;
+
+    REQUIRE(transformation.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_INTEGER_SHIFT);
+
+    for (auto interpolation : { INTERPOLATION_BILINEAR, INTERPOLATION_BICUBIC, INTERPOLATION_LANCZOS3 })
+    {
+        UInt8ColorBitmap* transformed = transformation.transform(&bitmap, interpolation);
+
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                const int sx = x + 4;
+                const int sy = y - 7;
+                const bool inside = (sx >= 0) && (sx < WIDTH) && (sy >= 0) && (sy < HEIGHT);
+
+                for (int c = 0; c < 3; ++c)
+                    REQUIRE(*(transformed->data(x, y) + c) == (inside ? *(bitmap.data(sx, sy) + c) : 0));
+            }
+        }
+
+        delete transformed;
+    }
+}
+
+
+TEST_CASE("Shift of a bitmap by more than its size", "[Transformation]")
+{
+    const int WIDTH = 20;
+    const int HEIGHT = 10;
+
+    UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        *(bitmap.data() + i) = 1 + i;
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+
+    SECTION("horizontally")
+    {
+        transformation.a0 = 25.0 / WIDTH;
+    }
+
+    SECTION("to the left")
+    {
+        transformation.a0 = -30.0 / WIDTH;
+        transformation.b0 = 2.0 / HEIGHT;
+    }
+
+    REQUIRE(transformation.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_INTEGER_SHIFT);
+
+    UInt16ColorBitmap* transformed = transformation.transform(&bitmap);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        REQUIRE(*(transformed->data() + i) == 0);
+
+    delete transformed;
+}
+
+
+TEST_CASE("Fast path of the transformation of a bitmap (subpixel shift)", "[Transformation]")
+{
+    const unsigned int WIDTH = 50;
+    const unsigned int HEIGHT = 40;
+
+    // Smooth content, so a slightly different transformation gives almost the same
+    // pixels
+    UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            for (int c = 0; c < 3; ++c)
+                *(bitmap.data(x, y) + c) = 1000 + 7 * x + 11 * y + 100 * c;
+        }
+    }
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+    transformation.a0 = 2.3 / WIDTH;
+    transformation.b0 = -1.6 / HEIGHT;
+
+    REQUIRE(transformation.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_SUBPIXEL_SHIFT);
+
+    // Generic transformation moving the pixels by at most 0.05 pixel more than the shift
+    Transformation reference = transformation;
+    reference.a3 = 0.05 / WIDTH;
+
+    REQUIRE(reference.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_GENERIC);
+
+    for (auto interpolation : { INTERPOLATION_BILINEAR, INTERPOLATION_BICUBIC, INTERPOLATION_LANCZOS3 })
+    {
+        UInt16ColorBitmap* expected = reference.transform(&bitmap, interpolation);
+        UInt16ColorBitmap* transformed = transformation.transform(&bitmap, interpolation);
+
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            REQUIRE(std::abs(int(*(transformed->data() + i)) - int(*(expected->data() + i))) <= 1);
+
+        delete expected;
+        delete transformed;
+    }
+}
+
+
+TEST_CASE("Fast path of the transformation of a bitmap (rigid)", "[Transformation]")
+{
+    const unsigned int WIDTH = 50;
+    const unsigned int HEIGHT = 40;
+
+    // Smooth content, so a slightly different transformation gives almost the same
+    // pixels
+    UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            for (int c = 0; c < 3; ++c)
+                *(bitmap.data(x, y) + c) = 1000 + 7 * x + 11 * y + 100 * c;
+        }
+    }
+
+    // Like a fitted transformation: rotation, shift and tiny 'X * Y' terms
+    const double angle = 0.02;
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+    transformation.a0 = 2.3 / WIDTH;
+    transformation.a1 = cos(angle);
+    transformation.a2 = -sin(angle) * HEIGHT / WIDTH;
+    transformation.a3 = 0.002 / WIDTH;
+    transformation.b0 = -1.6 / HEIGHT;
+    transformation.b1 = sin(angle) * WIDTH / HEIGHT;
+    transformation.b2 = cos(angle);
+    transformation.b3 = -0.003 / HEIGHT;
+
+    REQUIRE(transformation.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_RIGID);
+
+    // Generic transformation moving the pixels by at most 0.05 pixel more
+    Transformation reference = transformation;
+    reference.a3 = 0.05 / WIDTH;
+
+    REQUIRE(reference.classify(size2d_t(WIDTH, HEIGHT)) == TRANSFORMATION_GENERIC);
+
+    for (auto interpolation : { INTERPOLATION_BILINEAR, INTERPOLATION_BICUBIC, INTERPOLATION_LANCZOS3 })
+    {
+        UInt16ColorBitmap* expected = reference.transform(&bitmap, interpolation);
+        UInt16ColorBitmap* transformed = transformation.transform(&bitmap, interpolation);
+
+        // The pixels at the borders can be inside the source bitmap for only one of
+        // the transformations
+        unsigned int nbCompared = 0;
+
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        {
+            const int value = *(transformed->data() + i);
+            const int expectedValue = *(expected->data() + i);
+
+            if ((value == 0) || (expectedValue == 0))
+                continue;
+
+            REQUIRE(std::abs(value - expectedValue) <= 1);
+            ++nbCompared;
+        }
+
+        REQUIRE(nbCompared > WIDTH * HEIGHT * 3 * 3 / 4);
+
+        delete expected;
+        delete transformed;
+    }
+}
+
+
+TEST_CASE("Transformation of bands of rows", "[Transformation]")
+{
+    const unsigned int WIDTH = 30;
+    const unsigned int HEIGHT = 20;
+
+    UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        *(bitmap.data() + i) = (i * 37) % 1000 + 1;
+
+    Transformation transformation;
+    transformation.xWidth = WIDTH;
+    transformation.yWidth = HEIGHT;
+
+    SECTION("identity")
+    {
+    }
+
+    SECTION("integer shift")
+    {
+        transformation.a0 = 2.0 / WIDTH;
+        transformation.b0 = -3.0 / HEIGHT;
+    }
+
+    SECTION("subpixel shift")
+    {
+        transformation.a0 = -1.5 / WIDTH;
+        transformation.b0 = 2.25 / HEIGHT;
+    }
+
+    SECTION("rigid")
+    {
+        const double angle = 0.05;
+        transformation.a0 = 1.2 / WIDTH;
+        transformation.a1 = cos(angle);
+        transformation.a2 = -sin(angle) * HEIGHT / WIDTH;
+        transformation.b1 = sin(angle) * WIDTH / HEIGHT;
+        transformation.b2 = cos(angle);
+    }
+
+    SECTION("generic")
+    {
+        transformation.a0 = 0.01;
+        transformation.a1 = 0.99;
+        transformation.a2 = 0.05;
+        transformation.a3 = 0.01;
+        transformation.b0 = -0.03;
+        transformation.b1 = -0.04;
+        transformation.b2 = 1.02;
+    }
+
+    UInt16ColorBitmap* reference = transformation.transform(&bitmap, INTERPOLATION_BICUBIC);
+
+    // All the pixels of the bands must be written, even the ones outside of the source
+    // bitmap
+    const unsigned int BAND_HEIGHT = 7;
+    std::vector<uint16_t> rows(WIDTH * 3 * BAND_HEIGHT);
+
+    // The kind of the transformation and the threads can also be shared by all the bands
+    const transformation_class_t kind = transformation.classify(size2d_t(WIDTH, HEIGHT));
+    WorkerPool workers(3);
+
+    for (bool shared : { false, true })
+    {
+        for (int left : { 0, 3 })
+        {
+            const int right = (left == 0 ? WIDTH : WIDTH - 4);
+            const int nbElements = (right - left) * 3;
+
+            for (int startRow = 0; startRow < HEIGHT; startRow += BAND_HEIGHT)
+            {
+                const rect_t area(left, startRow, right, std::min(startRow + BAND_HEIGHT, HEIGHT));
+
+                std::fill(rows.begin(), rows.end(), 12345);
+
+                if (shared)
+                    transformation.transform(&bitmap, rows.data(), area, kind, INTERPOLATION_BICUBIC, workers);
+                else
+                    transformation.transform(&bitmap, rows.data(), area, INTERPOLATION_BICUBIC);
+
+                for (int y = area.top; y < area.bottom; ++y)
+                {
+                    for (int i = 0; i < nbElements; ++i)
+                        REQUIRE(rows[(y - area.top) * nbElements + i] == *(reference->data(left, y) + i));
+                }
+            }
+        }
+    }
+
+    delete reference;
+}
@@ -33,3 +33,51 @@ TEST_CASE("Hot pixels removal", "[Bitmap helpers]")
     for (size_t i = 0; i < image.height() * image.width() * 3; ++i)
         REQUIRE(data[i] == 0.0f);
 }
+
+
+TEST_CASE("Luminance computation", "[Bitmap helpers]")
+{
+    UInt16ColorBitmap image(20, 10);
+
+    for (unsigned int y = 0; y < image.height(); ++y)
+    {
+        for (unsigned int x = 0; x < image.width(); ++x)
+        {
+            uint16_t* pixel = image.data(x, y);
+            pixel[0] = x * 1000;
+            pixel[1] = y * 2000;
+            pixel[2] = 5000;
+        }
+    }
+
+    DoubleColorBitmap color(&image, RANGE_ONE);
+
+    DoubleGrayBitmap* luminance = computeLuminanceBitmap(&image);
+    FloatGrayBitmap* floatLuminance = computeFloatLuminanceBitmap(&image);
+
+    REQUIRE(luminance->width() == image.width());
+    REQUIRE(luminance->height() == image.height());
+    REQUIRE(luminance->range() == RANGE_ONE);
+
+    REQUIRE(floatLuminance->width() == image.width());
+    REQUIRE(floatLuminance->height() == image.height());
+    REQUIRE(floatLuminance->range() == RANGE_ONE);
+
+    for (unsigned int y = 0; y < image.height(); ++y)
+    {
+        for (unsigned int x = 0; x < image.width(); ++x)
+        {
+            double* pixel = color.data(x, y);
+            double expected = (
+                std::min(pixel[0], std::min(pixel[1], pixel[2])) +
+                std::max(pixel[0], std::max(pixel[1], pixel[2]))
+            ) * 0.5;
+
+            REQUIRE(*luminance->data(x, y) == expected);
+            REQUIRE(*floatLuminance->data(x, y) == float(expected));
+        }
+    }
+
+    delete luminance;
+    delete floatLuminance;
+}
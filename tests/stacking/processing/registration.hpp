@@ -103,3 +103,39 @@ TEST_CASE("(Stacking/Processing/Registration) Registration process", "[Registrat
     REQUIRE(point2.x == Approx(point.x).margin(0.001));
     REQUIRE(point2.y == Approx(point.y).margin(0.001));
 }
+
+
+TEST_CASE("(Stacking/Processing/Registration) Registration of several frames in parallel", "[RegistrationProcessor]")
+{
+    REQUIRE(std::filesystem::exists(TEMP_DIR "lightframes/light1.fits"));
+    REQUIRE(std::filesystem::exists(TEMP_DIR "lightframes/light2.fits"));
+    REQUIRE(std::filesystem::exists(TEMP_DIR "lightframes/light3.fits"));
+
+    RegistrationProcessor<UInt16ColorBitmap> processor;
+
+    star_list_t refStars = processor.processReference(TEMP_DIR "lightframes/light1.fits");
+    REQUIRE(refStars.size() == 38);
+
+    std::vector<std::filesystem::path> lightFrames = {
+        TEMP_DIR "lightframes/light3.fits",
+        DATA_DIR "missing.fits",
+        TEMP_DIR "lightframes/light2.fits",
+    };
+
+    auto results = processor.process(lightFrames, {}, 2);
+    REQUIRE(results.size() == 3);
+
+    REQUIRE(get<0>(results[0]).size() == 34);
+
+    point_t point = get<1>(results[0]).transform(point_t(200, 100));
+    REQUIRE(point.x == Approx(136.686).margin(0.001));
+    REQUIRE(point.y == Approx(196.510).margin(0.001));
+
+    REQUIRE(get<0>(results[1]).empty());
+
+    REQUIRE(get<0>(results[2]).size() == 30);
+
+    point = get<1>(results[2]).transform(point_t(200, 100));
+    REQUIRE(point.x == Approx(216.529).margin(0.001));
+    REQUIRE(point.y == Approx(98.799).margin(0.001));
+}
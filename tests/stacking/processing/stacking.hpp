@@ -51,3 +51,33 @@ TEST_CASE("(Stacking/Processing/Stacking) Stacking of 3 light frames", "[FramesS
 
     REQUIRE(std::filesystem::exists(TEMP_DIR "stacked.fits"));
 }
+
+
+TEST_CASE("(Stacking/Processing/Stacking) Incremental stacking of 3 light frames", "[FramesStacker]")
+{
+    FramesStacker<UInt16ColorBitmap> stacker;
+    stacker.setup(3, TEMP_DIR "tmp_stacking", 50000000, true);
+
+    REQUIRE(stacker.addFrame(TEMP_DIR "lightframes/light1.fits"));
+    REQUIRE(stacker.addFrame(TEMP_DIR "lightframes/light2.fits"));
+
+    Bitmap* stacked = stacker.process("", false);
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == 1222);
+    REQUIRE(stacked->height() == 864);
+    delete stacked;
+
+    REQUIRE(stacker.addFrame(TEMP_DIR "lightframes/light3.fits"));
+
+    stacked = stacker.process("", false);
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == 1222);
+    REQUIRE(stacked->height() == 864);
+    delete stacked;
+
+    stacked = stacker.process();
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == 1222);
+    REQUIRE(stacked->height() == 864);
+    delete stacked;
+}
@@ -236,3 +236,37 @@ TEST_CASE("(Stacking/Threads/Stacking) Stacking", "[StackingThread]")
 
     REQUIRE(std::filesystem::exists(TEMP_DIR "threads/stacked.fits"));
 }
+
+
+TEST_CASE("(Stacking/Threads/Stacking) Incremental stacking", "[StackingThread]")
+{
+    REQUIRE(std::filesystem::exists(TEMP_DIR "threads/lightframes/light1.fits"));
+    REQUIRE(std::filesystem::exists(TEMP_DIR "threads/lightframes/light2.fits"));
+    REQUIRE(std::filesystem::exists(TEMP_DIR "threads/lightframes/light3.fits"));
+
+    std::filesystem::remove(TEMP_DIR "threads/stacked.fits");
+
+    StackingTestListener listener;
+    StackingThread<UInt16ColorBitmap> thread(&listener, TEMP_DIR "threads/stacked.fits");
+
+    REQUIRE(thread.setup(3, TEMP_DIR "threads/tmp_stacking", 50000000L, true));
+
+    REQUIRE(thread.start());
+
+    thread.processFrames({
+        TEMP_DIR "threads/lightframes/light1.fits",
+        TEMP_DIR "threads/lightframes/light2.fits",
+        TEMP_DIR "threads/lightframes/light3.fits"
+    });
+
+    thread.computeExactStacking();
+
+    REQUIRE(thread.stop());
+    thread.join();
+
+    REQUIRE(listener.nbFramesAtStart == 3);
+    REQUIRE(listener.nbFramesStacked == 3);
+    REQUIRE(listener.filename == TEMP_DIR "threads/stacked.fits");
+
+    REQUIRE(std::filesystem::exists(TEMP_DIR "threads/stacked.fits"));
+}
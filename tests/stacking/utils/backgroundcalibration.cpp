@@ -8,12 +8,76 @@
 
 #include <catch.hpp>
 #include <astrophoto-toolbox/stacking/utils/backgroundcalibration.h>
+#include <random>
 
 using namespace astrophototoolbox;
 using namespace astrophototoolbox::stacking;
 using namespace astrophototoolbox::stacking::utils;
 
 
+template<class BITMAP>
+void fillRandomly(BITMAP& bitmap, double maxValue)
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<double> distribution(0.2 * maxValue, 0.05 * maxValue);
+
+    typename BITMAP::type_t* data = bitmap.data();
+    for (unsigned int i = 0; i < bitmap.width() * bitmap.height() * BITMAP::Channels; ++i)
+        data[i] = (typename BITMAP::type_t) std::min(std::max(distribution(generator), 0.0), maxValue);
+}
+
+
+// Parameters computed from the histogram of each channel, as 'computeHistogram()' does
+template<class BITMAP>
+std::vector<double> referenceParameters(const BITMAP& bitmap)
+{
+    std::vector<double> parameters;
+
+    for (unsigned int c = 0; c < BITMAP::Channels; ++c)
+    {
+        histogram_t histogram;
+        computeHistogram(&bitmap, histogram, c);
+
+        size_t max = histogram.size() - 1;
+        while ((max > 0) && (histogram[max] == 0))
+            --max;
+
+        size_t nbValues = 0;
+        size_t index = 0;
+        while (nbValues < (bitmap.width() * bitmap.height()) / 2)
+            nbValues += histogram[index++];
+
+        parameters.push_back(double(index) / 65535.0 * bitmap.maxRangeValue());
+        parameters.push_back(double(max) / 65535.0 * bitmap.maxRangeValue());
+    }
+
+    return parameters;
+}
+
+
+template<class BITMAP>
+void checkParameters(const BITMAP& bitmap, unsigned int nbThreads)
+{
+    BackgroundCalibration<BITMAP> calibration;
+    calibration.setNbThreads(nbThreads);
+    calibration.setReference((BITMAP*) &bitmap);
+
+    auto parameters = calibration.getParameters();
+    auto expected = referenceParameters(bitmap);
+
+    REQUIRE(parameters.redBackground == expected[0]);
+    REQUIRE(parameters.redMax == expected[1]);
+
+    if constexpr (BITMAP::Channels == 3)
+    {
+        REQUIRE(parameters.greenBackground == expected[2]);
+        REQUIRE(parameters.greenMax == expected[3]);
+        REQUIRE(parameters.blueBackground == expected[4]);
+        REQUIRE(parameters.blueMax == expected[5]);
+    }
+}
+
+
 TEST_CASE("Background calibration with bitmap as reference", "[BackgroundCalibration]")
 {
     UInt16ColorBitmap ref(10, 3);
@@ -69,3 +133,164 @@ TEST_CASE("Background calibration with parameters", "[BackgroundCalibration]")
     for (unsigned int i = 0; i < bitmap.width() * bitmap.height() * 3; ++i)
         REQUIRE(data[i] == 100);
 }
+
+
+template<class BITMAP>
+void checkCalibration(unsigned int width, unsigned int height, double maxValue)
+{
+    BITMAP bitmap(width, height);
+    fillRandomly(bitmap, maxValue);
+
+    background_calibration_parameters_t parameters;
+    parameters.redBackground = 0.1 * maxValue;
+    parameters.greenBackground = 0.15 * maxValue;
+    parameters.blueBackground = 0.12 * maxValue;
+    parameters.redMax = 0.9 * maxValue;
+    parameters.greenMax = 0.8 * maxValue;
+    parameters.blueMax = 0.85 * maxValue;
+
+    BackgroundCalibration<BITMAP> calibration;
+    calibration.setParameters(parameters);
+
+    // Calibrate each value as 'Interpolation::interpolate()' does it
+    BackgroundCalibration<BITMAP> sourceCalibration;
+    sourceCalibration.setReference(&bitmap);
+    auto src = sourceCalibration.getParameters();
+
+    const double backgrounds[] = { parameters.redBackground, parameters.greenBackground, parameters.blueBackground };
+    const double maxs[] = { parameters.redMax, parameters.greenMax, parameters.blueMax };
+    const double srcBackgrounds[] = { src.redBackground, src.greenBackground, src.blueBackground };
+    const double srcMaxs[] = { src.redMax, src.greenMax, src.blueMax };
+
+    std::vector<typename BITMAP::type_t> expected(bitmap.data(), bitmap.data() + width * height * BITMAP::Channels);
+    for (unsigned int c = 0; c < BITMAP::Channels; ++c)
+    {
+        Interpolation interpolation(0.0, srcBackgrounds[c], srcMaxs[c], 0.0, backgrounds[c], maxs[c]);
+
+        for (size_t i = c; i < expected.size(); i += BITMAP::Channels)
+            expected[i] = interpolation.interpolate(expected[i]);
+    }
+
+    calibration.calibrate(&bitmap);
+
+    const typename BITMAP::type_t* data = bitmap.data();
+    for (size_t i = 0; i < expected.size(); ++i)
+        REQUIRE(data[i] == expected[i]);
+}
+
+
+TEST_CASE("Background calibration of all bitmap types", "[BackgroundCalibration]")
+{
+    SECTION("UInt8 color")
+    {
+        checkCalibration<UInt8ColorBitmap>(20, 15, 255.0);
+    }
+
+    SECTION("UInt8 color (using lookup tables)")
+    {
+        checkCalibration<UInt8ColorBitmap>(101, 67, 255.0);
+    }
+
+    SECTION("UInt16 color")
+    {
+        checkCalibration<UInt16ColorBitmap>(101, 67, 65535.0);
+    }
+
+    SECTION("UInt16 color (using lookup tables)")
+    {
+        checkCalibration<UInt16ColorBitmap>(301, 257, 65535.0);
+    }
+
+    SECTION("UInt16 grayscale (using lookup tables)")
+    {
+        checkCalibration<UInt16GrayBitmap>(301, 257, 65535.0);
+    }
+
+    SECTION("UInt32 color")
+    {
+        checkCalibration<UInt32ColorBitmap>(101, 67, 4294967295.0);
+    }
+
+    SECTION("Float color")
+    {
+        checkCalibration<FloatColorBitmap>(101, 67, 1.0);
+    }
+
+    SECTION("Double grayscale")
+    {
+        checkCalibration<DoubleGrayBitmap>(101, 67, 1.0);
+    }
+}
+
+
+TEST_CASE("Background calibration parameters of all bitmap types", "[BackgroundCalibration]")
+{
+    for (unsigned int nbThreads : { 1, 3 })
+    {
+        SECTION("UInt8 color, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            UInt8ColorBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 255.0);
+            checkParameters(bitmap, nbThreads);
+        }
+
+        SECTION("UInt16 color, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            UInt16ColorBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 65535.0);
+            checkParameters(bitmap, nbThreads);
+        }
+
+        SECTION("UInt32 color, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            UInt32ColorBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 4294967295.0);
+            checkParameters(bitmap, nbThreads);
+        }
+
+        SECTION("Float color, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            FloatColorBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 1.0);
+            checkParameters(bitmap, nbThreads);
+        }
+
+        SECTION("UInt16 grayscale, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            UInt16GrayBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 65535.0);
+            checkParameters(bitmap, nbThreads);
+        }
+
+        SECTION("Double grayscale, " + std::to_string(nbThreads) + " thread(s)")
+        {
+            DoubleGrayBitmap bitmap(101, 67);
+            fillRandomly(bitmap, 1.0);
+            checkParameters(bitmap, nbThreads);
+        }
+    }
+}
+
+
+TEST_CASE("Background calibration parameters using subsampling", "[BackgroundCalibration]")
+{
+    UInt16ColorBitmap bitmap(400, 300);
+    fillRandomly(bitmap, 65535.0);
+
+    BackgroundCalibration<UInt16ColorBitmap> calibration;
+    calibration.setReference(&bitmap);
+
+    BackgroundCalibration<UInt16ColorBitmap> subsampledCalibration;
+    subsampledCalibration.setSubsampling(4);
+    subsampledCalibration.setReference(&bitmap);
+
+    auto parameters = calibration.getParameters();
+    auto subsampledParameters = subsampledCalibration.getParameters();
+
+    REQUIRE(subsampledParameters.redBackground == Approx(parameters.redBackground).epsilon(0.01));
+    REQUIRE(subsampledParameters.greenBackground == Approx(parameters.greenBackground).epsilon(0.01));
+    REQUIRE(subsampledParameters.blueBackground == Approx(parameters.blueBackground).epsilon(0.01));
+    REQUIRE(subsampledParameters.redMax == parameters.redMax);
+    REQUIRE(subsampledParameters.greenMax == parameters.greenMax);
+    REQUIRE(subsampledParameters.blueMax == parameters.blueMax);
+}
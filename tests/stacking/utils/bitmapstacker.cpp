@@ -8,20 +8,21 @@
 
 #include <catch.hpp>
 #include <astrophoto-toolbox/stacking/utils/bitmapstacker.h>
+#include <thread>
 
 using namespace astrophototoolbox;
 using namespace astrophototoolbox::stacking;
 using namespace astrophototoolbox::stacking::utils;
 
 
-TEST_CASE("Adding bitmaps populates temporary files", "[BitmapStacker]")
+TEST_CASE("Adding bitmaps populates the temporary file", "[BitmapStacker]")
 {
     const unsigned int NB_IMAGES = 3;
     const unsigned int WIDTH = 10;
     const unsigned int HEIGHT = 3;
 
     BitmapStacker<DoubleColorBitmap> stacker;
-    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking1", WIDTH * HEIGHT * NB_IMAGES * sizeof(double));
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking1", 50000000L, WIDTH * 3 * NB_IMAGES * sizeof(double));
 
     DoubleColorBitmap bitmap1(WIDTH, HEIGHT);
     DoubleColorBitmap bitmap2(WIDTH, HEIGHT);
@@ -35,46 +36,56 @@ TEST_CASE("Adding bitmaps populates temporary files", "[BitmapStacker]")
     }
 
     REQUIRE(stacker.addBitmap(&bitmap1));
-    REQUIRE(stacker.addBitmap(&bitmap2));
-    REQUIRE(stacker.addBitmap(&bitmap3));
 
     std::filesystem::path folder(TEMP_DIR "bitmapstacking1");
     REQUIRE(std::filesystem::exists(folder));
+    REQUIRE(std::filesystem::exists(folder / "stack.dat"));
+
+    // The file is preallocated for all the expected bitmaps
+    const size_t frameSize = WIDTH * HEIGHT * 3 * sizeof(double);
+    REQUIRE(std::filesystem::file_size(folder / "stack.dat") == NB_IMAGES * frameSize);
+
+    REQUIRE(stacker.addBitmap(&bitmap2));
+    REQUIRE(stacker.addBitmap(&bitmap3));
 
-    const char* filenames[NB_IMAGES] = {
-        "part0000.dat",
-        "part0001.dat",
-        "part0002.dat",
-    };
+    REQUIRE(std::filesystem::file_size(folder / "stack.dat") == NB_IMAGES * frameSize);
 
-    for (int j = 0; j < NB_IMAGES; ++j)
-        REQUIRE(std::filesystem::exists(folder / filenames[j]));
+    double buffer[WIDTH * HEIGHT * NB_IMAGES * 3];
 
-    REQUIRE(!std::filesystem::exists(folder / "part0003.dat"));
+    FILE* f = std::fopen((folder / "stack.dat").string().c_str(), "rb");
+    REQUIRE(f);
 
-    double buffer[WIDTH * NB_IMAGES * 3];
+    size_t nb = fread(buffer, sizeof(double), WIDTH * HEIGHT * NB_IMAGES * 3, f);
+    fclose(f);
 
-    for (int j = 0; j < NB_IMAGES; ++j)
+    REQUIRE(nb == WIDTH * HEIGHT * NB_IMAGES * 3);
+
+    // The bitmaps are stored one after the other
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
     {
-        FILE* f = std::fopen((folder / filenames[j]).string().c_str(), "rb");
-        REQUIRE(f);
+        REQUIRE(buffer[i] == Approx(i));
+        REQUIRE(buffer[i + WIDTH * HEIGHT * 3] == Approx(i + 100));
+        REQUIRE(buffer[i + WIDTH * HEIGHT * 3 * 2] == Approx(i + 200));
+    }
 
-        size_t nb = fread(buffer, sizeof(double), WIDTH * NB_IMAGES * 3, f);
-        fclose(f);
+    SECTION("more bitmaps than expected")
+    {
+        REQUIRE(stacker.addBitmap(&bitmap3));
+        REQUIRE(std::filesystem::file_size(folder / "stack.dat") > NB_IMAGES * frameSize);
 
-        double* ptr = buffer;
-        double start = j * WIDTH * 3;
+        DoubleColorBitmap* stacked = stacker.process();
+        REQUIRE(stacked);
 
-        for (int i = 0; i < WIDTH * 3; ++i)
-        {
-            REQUIRE(ptr[i] == Approx(start + i));
-            REQUIRE(ptr[i + WIDTH * 3] == Approx(start + i + 100));
-            REQUIRE(ptr[i + WIDTH * 3 * 2] == Approx(start + i + 200));
-        }
+        // Median of 4 values: the lower of the two middle values (the first pixel is
+        // skipped, since it contains a 0)
+        for (int i = 1; i < WIDTH * HEIGHT * 3; ++i)
+            REQUIRE(*(stacked->data() + i) == Approx(i + 100));
+
+        delete stacked;
     }
 
     stacker.clear();
-    REQUIRE(!std::filesystem::exists(folder / "part0000.dat"));
+    REQUIRE(!std::filesystem::exists(folder / "stack.dat"));
 }
 
 
@@ -88,12 +99,12 @@ TEST_CASE("Stacking color bitmaps", "[BitmapStacker]")
 
     REQUIRE(!stacker.isInitialised());
 
-    SECTION("using small temporary files")
+    SECTION("using a temporary file")
     {
-        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking2", WIDTH * HEIGHT * NB_IMAGES * sizeof(double));
+        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking2", 50000000L, WIDTH * 3 * NB_IMAGES * sizeof(double));
     }
 
-    SECTION("using big temporary files")
+    SECTION("in memory")
     {
         stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking3");
     }
@@ -142,12 +153,12 @@ TEST_CASE("Stacking grayscale bitmaps", "[BitmapStacker]")
 
     BitmapStacker<UInt16GrayBitmap> stacker;
 
-    SECTION("using small temporary files")
+    SECTION("using a temporary file")
     {
-        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking4", WIDTH * HEIGHT * NB_IMAGES * sizeof(uint16_t));
+        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking4", 50000000L, WIDTH * NB_IMAGES * sizeof(uint16_t));
     }
 
-    SECTION("using big temporary files")
+    SECTION("in memory")
     {
         stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking5");
     }
@@ -184,3 +195,713 @@ TEST_CASE("Stacking grayscale bitmaps", "[BitmapStacker]")
 
     delete stacked;
 }
+
+
+TEST_CASE("Stacking is exact for 32-bit integers", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 5;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 3;
+
+    BitmapStacker<UInt32ColorBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking6");
+
+    std::vector<UInt32ColorBitmap*> bitmaps;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt32ColorBitmap* bitmap = new UInt32ColorBitmap(WIDTH, HEIGHT);
+
+        // Values that can't be represented with a 16-bit histogram, in a shuffled order
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            *(bitmap->data() + i) = 100000 + i * 7 + ((k * 3) % NB_IMAGES);
+
+        REQUIRE(stacker.addBitmap(bitmap));
+        bitmaps.push_back(bitmap);
+    }
+
+    UInt32ColorBitmap* stacked = stacker.process();
+
+    REQUIRE(stacked);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        uint32_t* ptr = stacked->data(j);
+
+        for (int i = 0; i < WIDTH * 3; ++i)
+            REQUIRE(ptr[i] == 100000 + (j * WIDTH * 3 + i) * 7 + 2);
+    }
+
+    delete stacked;
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking with several threads", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 4;
+    const unsigned int WIDTH = 50;
+    const unsigned int HEIGHT = 40;
+
+    std::vector<UInt16ColorBitmap*> bitmaps;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap* bitmap = new UInt16ColorBitmap(WIDTH, HEIGHT);
+
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            *(bitmap->data() + i) = (i * 13 + k * 7919) % 65536;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    BitmapStacker<UInt16ColorBitmap> reference;
+    reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking7", 50000000L, WIDTH * 3 * 2 * 10);
+    reference.setNbThreads(1);
+
+    BitmapStacker<UInt16ColorBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking8", 50000000L, WIDTH * 3 * 2 * 10);
+    stacker.setNbThreads(4);
+
+    for (auto bitmap : bitmaps)
+    {
+        REQUIRE(reference.addBitmap(bitmap));
+        REQUIRE(stacker.addBitmap(bitmap));
+    }
+
+    UInt16ColorBitmap* expected = reference.process();
+    UInt16ColorBitmap* stacked = stacker.process();
+
+    REQUIRE(expected);
+    REQUIRE(stacked);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        uint16_t* ptr = stacked->data(j);
+        uint16_t* ref = expected->data(j);
+
+        for (int i = 0; i < WIDTH * 3; ++i)
+            REQUIRE(ptr[i] == ref[i]);
+    }
+
+    delete expected;
+    delete stacked;
+
+    SECTION("cancellation")
+    {
+        stacker.cancel();
+        REQUIRE(!stacker.process());
+    }
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking with other methods", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 5;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 3;
+
+    std::filesystem::path folder(TEMP_DIR "bitmapstacking9");
+
+    std::vector<UInt16GrayBitmap*> bitmaps;
+    const uint16_t values[NB_IMAGES] = { 100, 102, 98, 100, 5000 };
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16GrayBitmap* bitmap = new UInt16GrayBitmap(WIDTH, HEIGHT);
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+            *(bitmap->data() + i) = values[k] + i;
+
+        // Pixels with a value of 0 must be ignored
+        *(bitmap->data() + WIDTH + 1) = 0;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    BitmapStacker<UInt16GrayBitmap> stacker;
+    stacker.setup(NB_IMAGES, folder, 50000000L, WIDTH * NB_IMAGES * sizeof(uint16_t));
+
+    uint16_t expected = 0;
+    double weights[NB_IMAGES] = { 1.0, 1.0, 1.0, 1.0, 1.0 };
+    bool usesTemporaryFiles = true;
+
+    SECTION("average")
+    {
+        stacker.setup(NB_IMAGES, folder, 50000000L, WIDTH * HEIGHT * 2 * sizeof(float));
+        stacker.setMethod(METHOD_AVERAGE);
+        expected = 1080;
+        usesTemporaryFiles = false;
+    }
+
+    SECTION("weighted average")
+    {
+        stacker.setup(NB_IMAGES, folder, 50000000L, WIDTH * HEIGHT * 2 * sizeof(float));
+        stacker.setMethod(METHOD_WEIGHTED_AVERAGE);
+        weights[0] = 3.0;
+        weights[4] = 0.0;
+        expected = 100;
+        usesTemporaryFiles = false;
+    }
+
+    SECTION("average, when the running means don't fit in the budget")
+    {
+        stacker.setMethod(METHOD_AVERAGE);
+        expected = 1080;
+    }
+
+    SECTION("weighted average, when the running means don't fit in the budget")
+    {
+        stacker.setMethod(METHOD_WEIGHTED_AVERAGE);
+        weights[0] = 3.0;
+        weights[4] = 0.0;
+        expected = 100;
+    }
+
+    SECTION("kappa-sigma clipping")
+    {
+        stacker.setMethod(METHOD_KAPPA_SIGMA, 1.5, 5);
+        expected = 100;
+    }
+
+    SECTION("winsorized sigma clipping")
+    {
+        stacker.setMethod(METHOD_WINSORIZED_SIGMA, 3.0, 10);
+        expected = 100;
+    }
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+        REQUIRE(stacker.addBitmap(bitmaps[k], weights[k]));
+
+    REQUIRE(std::filesystem::exists(folder / "stack.dat") == usesTemporaryFiles);
+
+    UInt16GrayBitmap* stacked = stacker.process();
+
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == WIDTH);
+    REQUIRE(stacked->height() == HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        if (i != WIDTH + 1)
+            REQUIRE(*(stacked->data() + i) == expected + i);
+        else
+            REQUIRE(*(stacked->data() + i) == 0);
+    }
+
+    delete stacked;
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking with a pixel-major layout", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 7;
+    const unsigned int WIDTH = 50;
+    const unsigned int HEIGHT = 40;
+
+    std::vector<UInt16ColorBitmap*> bitmaps;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap* bitmap = new UInt16ColorBitmap(WIDTH, HEIGHT);
+
+        // Includes some 0 values, which must be ignored
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            *(bitmap->data() + i) = (i * 13 + k * 7919) % 4099;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    stacking_method_t method = METHOD_MEDIAN;
+
+    SECTION("median")
+    {
+        method = METHOD_MEDIAN;
+    }
+
+    SECTION("kappa-sigma clipping")
+    {
+        method = METHOD_KAPPA_SIGMA;
+    }
+
+    BitmapStacker<UInt16ColorBitmap> reference;
+    reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking10", 50000000L, WIDTH * 3 * 2 * 10);
+    reference.setMethod(method);
+
+    BitmapStacker<UInt16ColorBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking11", 50000000L, WIDTH * 3 * 2 * 10);
+    stacker.setMethod(method);
+    stacker.setPixelMajorLayout(true);
+
+    for (auto bitmap : bitmaps)
+    {
+        REQUIRE(reference.addBitmap(bitmap));
+        REQUIRE(stacker.addBitmap(bitmap));
+    }
+
+    UInt16ColorBitmap* expected = reference.process();
+    UInt16ColorBitmap* stacked = stacker.process();
+
+    REQUIRE(expected);
+    REQUIRE(stacked);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        uint16_t* ptr = stacked->data(j);
+        uint16_t* ref = expected->data(j);
+
+        for (int i = 0; i < WIDTH * 3; ++i)
+            REQUIRE(ptr[i] == ref[i]);
+    }
+
+    delete expected;
+    delete stacked;
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking with prefetched bands", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 5;
+    const unsigned int WIDTH = 100;
+    const unsigned int HEIGHT = 60;
+
+    std::vector<UInt16GrayBitmap*> bitmaps;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16GrayBitmap* bitmap = new UInt16GrayBitmap(WIDTH, HEIGHT);
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+            *(bitmap->data() + i) = (i * 31 + k * 7919) % 65536;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    BitmapStacker<UInt16GrayBitmap> reference;
+    reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking12", 50000000L, WIDTH * 2 * NB_IMAGES * 4);
+    reference.setNbPrefetchedBands(0);
+
+    BitmapStacker<UInt16GrayBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking13", 50000000L, WIDTH * 2 * NB_IMAGES * 4);
+
+    SECTION("double buffering")
+    {
+        stacker.setNbPrefetchedBands(1);
+    }
+
+    SECTION("several bands in advance")
+    {
+        stacker.setNbPrefetchedBands(4);
+    }
+
+    for (auto bitmap : bitmaps)
+    {
+        REQUIRE(reference.addBitmap(bitmap));
+        REQUIRE(stacker.addBitmap(bitmap));
+    }
+
+    UInt16GrayBitmap* expected = reference.process();
+    UInt16GrayBitmap* stacked = stacker.process();
+
+    REQUIRE(expected);
+    REQUIRE(stacked);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        uint16_t* ptr = stacked->data(j);
+        uint16_t* ref = expected->data(j);
+
+        for (int i = 0; i < WIDTH; ++i)
+            REQUIRE(ptr[i] == ref[i]);
+    }
+
+    delete expected;
+    delete stacked;
+
+    SECTION("cancellation")
+    {
+        stacker.cancel();
+        REQUIRE(!stacker.process());
+    }
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking in memory", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 3;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 3;
+    const size_t FRAME_SIZE = WIDTH * HEIGHT * sizeof(uint16_t);
+
+    std::filesystem::path folder(TEMP_DIR "bitmapstacking14");
+
+    UInt16GrayBitmap bitmap1(WIDTH, HEIGHT);
+    UInt16GrayBitmap bitmap2(WIDTH, HEIGHT);
+    UInt16GrayBitmap bitmap3(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        *(bitmap1.data() + i) = i + 10;
+        *(bitmap2.data() + i) = i + 30;
+        *(bitmap3.data() + i) = i + 20;
+    }
+
+    BitmapStacker<UInt16GrayBitmap> stacker;
+
+    SECTION("when the bitmaps fit in the budget")
+    {
+        stacker.setup(NB_IMAGES, folder);
+
+        REQUIRE(stacker.addBitmap(&bitmap1));
+        REQUIRE(stacker.addBitmap(&bitmap2));
+        REQUIRE(stacker.addBitmap(&bitmap3));
+        REQUIRE(stacker.addBitmap(&bitmap1));
+        REQUIRE(stacker.addBitmap(&bitmap2));
+
+        REQUIRE(!std::filesystem::exists(folder / "stack.dat"));
+    }
+
+    SECTION("when more bitmaps than expected don't fit in the budget")
+    {
+        stacker.setup(NB_IMAGES, folder, 50000000L, FRAME_SIZE * 4);
+
+        REQUIRE(stacker.addBitmap(&bitmap1));
+        REQUIRE(stacker.addBitmap(&bitmap2));
+        REQUIRE(stacker.addBitmap(&bitmap3));
+        REQUIRE(stacker.addBitmap(&bitmap1));
+
+        REQUIRE(!std::filesystem::exists(folder / "stack.dat"));
+
+        REQUIRE(stacker.addBitmap(&bitmap2));
+
+        REQUIRE(std::filesystem::exists(folder / "stack.dat"));
+        REQUIRE(std::filesystem::file_size(folder / "stack.dat") >= 5 * FRAME_SIZE);
+    }
+
+    REQUIRE(stacker.nbStackedBitmaps() == 5);
+
+    UInt16GrayBitmap* stacked = stacker.process();
+
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == WIDTH);
+    REQUIRE(stacked->height() == HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+        REQUIRE(*(stacked->data() + i) == i + 20);
+
+    delete stacked;
+
+    stacker.clear();
+    REQUIRE(!std::filesystem::exists(folder / "stack.dat"));
+}
+
+
+TEST_CASE("Adding bitmaps band by band", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 5;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 6;
+
+    std::vector<UInt16ColorBitmap*> bitmaps;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap* bitmap = new UInt16ColorBitmap(WIDTH, HEIGHT);
+
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            *(bitmap->data() + i) = 1000 + (i * 7 + k * 131) % 200;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    BitmapStacker<UInt16ColorBitmap> reference;
+    BitmapStacker<UInt16ColorBitmap> stacker;
+
+    SECTION("in memory")
+    {
+        reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking15");
+        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking16");
+    }
+
+    SECTION("using a temporary file")
+    {
+        reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking15", 50000000L, WIDTH * 3 * 2 * NB_IMAGES);
+        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking16", 50000000L, WIDTH * 3 * 2 * NB_IMAGES);
+    }
+
+    SECTION("using a temporary file read by small bands")
+    {
+        reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking15");
+        stacker.setup(
+            NB_IMAGES, TEMP_DIR "bitmapstacking16", WIDTH * 3 * 2 * NB_IMAGES,
+            WIDTH * HEIGHT * 3 * 2 * (NB_IMAGES - 1)
+        );
+    }
+
+    SECTION("with an average")
+    {
+        reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking15");
+        reference.setMethod(METHOD_AVERAGE);
+        stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking16");
+        stacker.setMethod(METHOD_AVERAGE);
+    }
+
+    for (auto bitmap : bitmaps)
+    {
+        REQUIRE(reference.addBitmap(bitmap));
+
+        unsigned int nextRow = 0;
+
+        REQUIRE(stacker.addBitmap(
+            WIDTH, HEIGHT, bitmap->range(),
+            [&](const rect_t& area, uint16_t* rows)
+            {
+                REQUIRE(area.left == 0);
+                REQUIRE(area.right == WIDTH);
+                REQUIRE(area.top == nextRow);
+                REQUIRE(area.bottom <= HEIGHT);
+
+                memcpy(rows, bitmap->data(area.top), area.height() * WIDTH * 3 * sizeof(uint16_t));
+                nextRow = area.bottom;
+            }
+        ));
+
+        REQUIRE(nextRow == HEIGHT);
+    }
+
+    UInt16ColorBitmap* expected = reference.process();
+    UInt16ColorBitmap* stacked = stacker.process();
+
+    REQUIRE(stacked);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+        REQUIRE(*(stacked->data() + i) == *(expected->data() + i));
+
+    delete expected;
+    delete stacked;
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking only the valid rectangles of the bitmaps", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 6;
+    const unsigned int WIDTH = 30;
+    const unsigned int HEIGHT = 20;
+
+    std::vector<UInt16ColorBitmap*> bitmaps;
+    std::vector<rect_t> rects;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap* bitmap = new UInt16ColorBitmap(WIDTH, HEIGHT);
+        rect_t rect(k, 3 - k / 2, WIDTH - 5 + k, HEIGHT - k);
+
+        // The pixels outside of the valid rectangle are missing (0)
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                const bool valid = (x >= rect.left) && (x < rect.right) &&
+                                   (y >= rect.top) && (y < rect.bottom);
+
+                for (int c = 0; c < 3; ++c)
+                    *(bitmap->data(x, y) + c) = (valid ? 1 + ((x + y * WIDTH) * 13 + c * 5 + k * 7919) % 4099 : 0);
+            }
+        }
+
+        bitmaps.push_back(bitmap);
+        rects.push_back(rect);
+    }
+
+    stacking_method_t method = METHOD_MEDIAN;
+    bool pixelMajor = false;
+    unsigned long memoryBudget = 1000000000L;
+
+    SECTION("median")
+    {
+        method = METHOD_MEDIAN;
+    }
+
+    SECTION("kappa-sigma clipping")
+    {
+        method = METHOD_KAPPA_SIGMA;
+    }
+
+    SECTION("average")
+    {
+        method = METHOD_AVERAGE;
+    }
+
+    SECTION("pixel-major layout")
+    {
+        pixelMajor = true;
+    }
+
+    SECTION("using a temporary file")
+    {
+        memoryBudget = WIDTH * 3 * 2 * 10;
+    }
+
+    SECTION("average, using a temporary file")
+    {
+        method = METHOD_AVERAGE;
+        memoryBudget = WIDTH * 3 * 2 * 10;
+    }
+
+    BitmapStacker<UInt16ColorBitmap> reference;
+    reference.setup(NB_IMAGES, TEMP_DIR "bitmapstacking17", 50000000L, memoryBudget);
+    reference.setMethod(method);
+
+    BitmapStacker<UInt16ColorBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking18", 50000000L, memoryBudget);
+    stacker.setMethod(method);
+    stacker.setPixelMajorLayout(pixelMajor);
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap* bitmap = bitmaps[k];
+        const rect_t& rect = rects[k];
+
+        REQUIRE(reference.addBitmap(bitmap));
+
+        // Only the valid rectangle must be requested
+        REQUIRE(stacker.addBitmap(
+            WIDTH, HEIGHT, bitmap->range(), rect,
+            [&](const rect_t& area, uint16_t* rows)
+            {
+                REQUIRE(area.left == rect.left);
+                REQUIRE(area.right == rect.right);
+                REQUIRE(area.top >= rect.top);
+                REQUIRE(area.bottom <= rect.bottom);
+
+                for (int y = area.top; y < area.bottom; ++y)
+                {
+                    memcpy(
+                        rows + (y - area.top) * area.width() * 3, bitmap->data(area.left, y),
+                        area.width() * 3 * sizeof(uint16_t)
+                    );
+                }
+            }
+        ));
+    }
+
+    // Full stacking
+    UInt16ColorBitmap* expected = reference.process();
+    UInt16ColorBitmap* stacked = stacker.process();
+
+    REQUIRE(expected);
+    REQUIRE(stacked);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        for (int i = 0; i < WIDTH * 3; ++i)
+            REQUIRE(stacked->data(j)[i] == expected->data(j)[i]);
+    }
+
+    delete stacked;
+
+    // Stacking of the common area only
+    rect_t area = rects[0];
+    for (const rect_t& rect : rects)
+        area = area.intersection(rect);
+
+    stacked = stacker.process(area);
+
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == area.width());
+    REQUIRE(stacked->height() == area.height());
+
+    for (int j = 0; j < area.height(); ++j)
+    {
+        uint16_t* ptr = stacked->data(j);
+        uint16_t* ref = expected->data(area.left, area.top + j);
+
+        for (int i = 0; i < area.width() * 3; ++i)
+            REQUIRE(ptr[i] == ref[i]);
+    }
+
+    delete expected;
+    delete stacked;
+
+    REQUIRE(!stacker.process(rect_t(WIDTH, 0, WIDTH + 10, HEIGHT)));
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
+
+
+TEST_CASE("Stacking several areas at the same time", "[BitmapStacker]")
+{
+    const unsigned int NB_IMAGES = 5;
+    const unsigned int WIDTH = 40;
+    const unsigned int HEIGHT = 32;
+    const unsigned int NB_AREAS = 4;
+
+    BitmapStacker<UInt16ColorBitmap> stacker;
+    stacker.setup(NB_IMAGES, TEMP_DIR "bitmapstacking19", 50000000L, WIDTH * 3 * 2 * 10);
+    stacker.setNbThreads(1);
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        UInt16ColorBitmap bitmap(WIDTH, HEIGHT);
+
+        uint16_t* data = bitmap.data();
+        for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+            data[i] = 1 + (i * 13 + k * 7919) % 4099;
+
+        REQUIRE(stacker.addBitmap(&bitmap));
+    }
+
+    UInt16ColorBitmap* expected = stacker.process();
+    REQUIRE(expected);
+
+    // Each thread maps the temporary file, and unmaps it when done
+    UInt16ColorBitmap* stacked[NB_AREAS] = { nullptr };
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < NB_AREAS; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            const rect_t area(0, i * HEIGHT / NB_AREAS, WIDTH, (i + 1) * HEIGHT / NB_AREAS);
+            stacked[i] = stacker.process(area);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (unsigned int i = 0; i < NB_AREAS; ++i)
+    {
+        REQUIRE(stacked[i]);
+
+        for (int j = 0; j < stacked[i]->height(); ++j)
+        {
+            uint16_t* ptr = stacked[i]->data(j);
+            uint16_t* ref = expected->data(i * HEIGHT / NB_AREAS + j);
+
+            for (int x = 0; x < WIDTH * 3; ++x)
+                REQUIRE(ptr[x] == ref[x]);
+        }
+
+        delete stacked[i];
+    }
+
+    delete expected;
+}
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <catch.hpp>
+#include <astrophoto-toolbox/stacking/utils/incrementalstacker.h>
+
+using namespace astrophototoolbox;
+using namespace astrophototoolbox::stacking;
+using namespace astrophototoolbox::stacking::utils;
+
+
+TEST_CASE("Incremental stacking of color bitmaps", "[IncrementalStacker]")
+{
+    const unsigned int NB_IMAGES = 3;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 3;
+
+    IncrementalStacker<DoubleColorBitmap> stacker;
+
+    DoubleColorBitmap bitmap1(WIDTH, HEIGHT);
+    DoubleColorBitmap bitmap2(WIDTH, HEIGHT);
+    DoubleColorBitmap bitmap3(WIDTH, HEIGHT);
+
+    for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+    {
+        *(bitmap1.data() + i) = double(i + 1) / 512.0;
+        *(bitmap2.data() + i) = double(i + 101) / 512.0;
+        *(bitmap3.data() + i) = double(i + 201) / 512.0;
+    }
+
+    stacker.addBitmap(&bitmap1);
+    stacker.addBitmap(&bitmap2);
+    stacker.addBitmap(&bitmap3);
+
+    REQUIRE(stacker.nbStackedBitmaps() == NB_IMAGES);
+
+    DoubleColorBitmap* stacked = stacker.process(ESTIMATE_MEAN);
+
+    REQUIRE(stacked);
+    REQUIRE(stacked->width() == WIDTH);
+    REQUIRE(stacked->height() == HEIGHT);
+
+    for (int j = 0; j < HEIGHT; ++j)
+    {
+        double* ptr = stacked->data(j);
+        double* ref = bitmap2.data(j);
+
+        for (int i = 0; i < WIDTH * 3; ++i)
+            REQUIRE(ptr[i] == Approx(ref[i]));
+    }
+
+    delete stacked;
+
+    stacker.clear();
+    REQUIRE(stacker.nbStackedBitmaps() == 0);
+}
+
+
+TEST_CASE("Incremental stacking of grayscale bitmaps", "[IncrementalStacker]")
+{
+    const unsigned int NB_IMAGES = 100;
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 3;
+
+    IncrementalStacker<UInt16GrayBitmap> stacker;
+
+    UInt16GrayBitmap bitmap(WIDTH, HEIGHT);
+
+    double sum = 0.0;
+
+    for (int k = 0; k < NB_IMAGES; ++k)
+    {
+        // Values between 95 and 105, with an outlier every 10 images
+        const uint16_t value = (k % 10 == 9 ? 5000 : 100 + (k * 7) % 11 - 5);
+        sum += value;
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+            *(bitmap.data() + i) = value;
+
+        // Pixels with a value of 0 must be ignored
+        *(bitmap.data() + WIDTH + 1) = 0;
+
+        stacker.addBitmap(&bitmap);
+    }
+
+    SECTION("mean")
+    {
+        UInt16GrayBitmap* stacked = stacker.process(ESTIMATE_MEAN);
+        REQUIRE(stacked);
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+        {
+            if (i != WIDTH + 1)
+                REQUIRE(*(stacked->data() + i) == uint16_t(sum / NB_IMAGES + 0.5));
+            else
+                REQUIRE(*(stacked->data() + i) == 0);
+        }
+
+        delete stacked;
+    }
+
+    SECTION("median")
+    {
+        UInt16GrayBitmap* stacked = stacker.process(ESTIMATE_MEDIAN);
+        REQUIRE(stacked);
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+        {
+            if (i != WIDTH + 1)
+                REQUIRE(*(stacked->data() + i) == Approx(100).margin(5));
+            else
+                REQUIRE(*(stacked->data() + i) == 0);
+        }
+
+        delete stacked;
+    }
+
+    SECTION("standard deviation")
+    {
+        UInt16GrayBitmap* stacked = stacker.processStandardDeviation();
+        REQUIRE(stacked);
+
+        REQUIRE(*(stacked->data()) > 1000);
+        REQUIRE(*(stacked->data() + WIDTH + 1) == 0);
+
+        delete stacked;
+    }
+}
+
+
+TEST_CASE("Incremental stacking band by band", "[IncrementalStacker]")
+{
+    const unsigned int WIDTH = 10;
+    const unsigned int HEIGHT = 5;
+
+    IncrementalStacker<UInt16GrayBitmap> reference;
+    IncrementalStacker<UInt16GrayBitmap> stacker;
+
+    std::vector<UInt16GrayBitmap*> bitmaps;
+
+    for (int k = 0; k < 5; ++k)
+    {
+        UInt16GrayBitmap* bitmap = new UInt16GrayBitmap(WIDTH, HEIGHT);
+
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+            *(bitmap->data() + i) = 1000 + (i * 7 + k * 131) % 200;
+
+        bitmaps.push_back(bitmap);
+    }
+
+    for (auto bitmap : bitmaps)
+    {
+        reference.addBitmap(bitmap);
+
+        stacker.beginBitmap(WIDTH, HEIGHT, bitmap->range());
+        stacker.addRows(rect_t(0, 3, WIDTH, 5), bitmap->data(3));
+        stacker.addRows(rect_t(0, 0, WIDTH, 3), bitmap->data(0));
+        stacker.endBitmap();
+    }
+
+    REQUIRE(stacker.nbStackedBitmaps() == 5);
+
+    UInt16GrayBitmap* expected = reference.process();
+    UInt16GrayBitmap* stacked = stacker.process();
+
+    for (int i = 0; i < WIDTH * HEIGHT; ++i)
+        REQUIRE(*(stacked->data() + i) == *(expected->data() + i));
+
+    delete expected;
+    delete stacked;
+
+    for (auto bitmap : bitmaps)
+        delete bitmap;
+}
@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <catch.hpp>
+#include <astrophoto-toolbox/stacking/utils/motionpredictor.h>
+
+using namespace astrophototoolbox;
+using namespace stacking::utils;
+
+
+TEST_CASE("Prediction of the next transformation", "[MotionPredictor]")
+{
+    MotionPredictor predictor;
+    Transformation prediction;
+
+    REQUIRE(!predictor.predict(prediction));
+
+    Transformation transformation;
+    transformation.xWidth = 1000.0;
+    transformation.yWidth = 800.0;
+    transformation.a0 = 0.01;
+    transformation.b0 = -0.02;
+
+    predictor.add(transformation);
+    REQUIRE(predictor.size() == 1);
+
+    REQUIRE(predictor.predict(prediction));
+    REQUIRE(prediction.a0 == Approx(0.01));
+    REQUIRE(prediction.b0 == Approx(-0.02));
+    REQUIRE(prediction.xWidth == 1000.0);
+    REQUIRE(prediction.yWidth == 800.0);
+
+    transformation.a0 = 0.015;
+    transformation.a1 = 1.001;
+    transformation.b0 = -0.01;
+
+    predictor.add(transformation);
+    REQUIRE(predictor.size() == 2);
+
+    REQUIRE(predictor.predict(prediction));
+    REQUIRE(prediction.a0 == Approx(0.02));
+    REQUIRE(prediction.a1 == Approx(1.002));
+    REQUIRE(prediction.a2 == Approx(0.0));
+    REQUIRE(prediction.a3 == Approx(0.0));
+    REQUIRE(prediction.b0 == Approx(0.0).margin(1e-9));
+    REQUIRE(prediction.b1 == Approx(0.0));
+    REQUIRE(prediction.b2 == Approx(1.0));
+    REQUIRE(prediction.b3 == Approx(0.0));
+
+    predictor.clear();
+    REQUIRE(predictor.size() == 0);
+    REQUIRE(!predictor.predict(prediction));
+}
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-FileContributor: Philip Abbet <philip.abbet@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <catch.hpp>
+#include <astrophoto-toolbox/stacking/utils/normalequations.h>
+
+using namespace astrophototoolbox;
+using namespace stacking::utils;
+
+
+TEST_CASE("Fit of a transformation", "[NormalEquations]")
+{
+    Transformation expected;
+    expected.xWidth = 1000.0;
+    expected.yWidth = 800.0;
+    expected.a0 = 0.05;
+    expected.a1 = 0.999;
+    expected.a2 = -0.02;
+    expected.a3 = 0.001;
+    expected.b0 = -0.1;
+    expected.b1 = 0.03;
+    expected.b2 = 1.001;
+    expected.b3 = -0.002;
+
+    NormalEquations equations(1000.0, 800.0);
+    Transformation transformation;
+
+    REQUIRE(!equations.solve(transformation));
+
+    for (int y = 100; y < 800; y += 200)
+    {
+        for (int x = 50; x < 1000; x += 300)
+        {
+            point_t from(x, y);
+            equations.add(from, expected.transform(from));
+        }
+    }
+
+    REQUIRE(equations.size() == 16);
+    REQUIRE(equations.solve(transformation));
+
+    REQUIRE(transformation.xWidth == 1000.0);
+    REQUIRE(transformation.yWidth == 800.0);
+    REQUIRE(transformation.a0 == Approx(expected.a0));
+    REQUIRE(transformation.a1 == Approx(expected.a1));
+    REQUIRE(transformation.a2 == Approx(expected.a2));
+    REQUIRE(transformation.a3 == Approx(expected.a3));
+    REQUIRE(transformation.b0 == Approx(expected.b0));
+    REQUIRE(transformation.b1 == Approx(expected.b1));
+    REQUIRE(transformation.b2 == Approx(expected.b2));
+    REQUIRE(transformation.b3 == Approx(expected.b3));
+
+    // Adding a wrong pair changes the fit, removing it restores it
+    equations.add(point_t(500, 400), point_t(700, 100));
+    REQUIRE(equations.solve(transformation));
+    REQUIRE(transformation.a0 != Approx(expected.a0));
+
+    equations.remove(point_t(500, 400), point_t(700, 100));
+    REQUIRE(equations.size() == 16);
+    REQUIRE(equations.solve(transformation));
+
+    REQUIRE(transformation.a0 == Approx(expected.a0));
+    REQUIRE(transformation.a1 == Approx(expected.a1));
+    REQUIRE(transformation.a2 == Approx(expected.a2));
+    REQUIRE(transformation.a3 == Approx(expected.a3));
+    REQUIRE(transformation.b0 == Approx(expected.b0));
+    REQUIRE(transformation.b1 == Approx(expected.b1));
+    REQUIRE(transformation.b2 == Approx(expected.b2));
+    REQUIRE(transformation.b3 == Approx(expected.b3));
+}
+
+
+TEST_CASE("Fit of a transformation with aligned points", "[NormalEquations]")
+{
+    NormalEquations equations(1000.0, 800.0);
+    Transformation transformation;
+
+    for (int x = 50; x < 1000; x += 100)
+        equations.add(point_t(x, 200), point_t(x + 10, 210));
+
+    REQUIRE(!equations.solve(transformation));
+
+    equations.clear();
+    REQUIRE(equations.size() == 0);
+    REQUIRE(!equations.solve(transformation));
+}
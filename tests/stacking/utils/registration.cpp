@@ -70,3 +70,48 @@ TEST_CASE("Registration of a bitmap", "[Registration]")
         REQUIRE(stars[i].intensity == Approx(ref[i].intensity).margin(0.001));
     }
 }
+
+
+TEST_CASE("Registration doesn't depend on the number of threads", "[Registration]")
+{
+    RawImage image;
+
+    REQUIRE(image.open(DATA_DIR "downloads/starfield.CR2"));
+
+    DoubleColorBitmap bitmap;
+    REQUIRE(image.toBitmap(&bitmap));
+
+    removeHotPixels(&bitmap);
+
+    int luminancyThreshold = 10;
+
+    SECTION("with a fixed threshold")
+    {
+        luminancyThreshold = 10;
+    }
+
+    SECTION("searching for a good threshold")
+    {
+        luminancyThreshold = -1;
+    }
+
+    stacking::utils::Registration registration1;
+    registration1.setNbThreads(1);
+
+    stacking::utils::Registration registration2;
+    registration2.setNbThreads(4);
+
+    star_list_t stars1 = registration1.registerBitmap(&bitmap, luminancyThreshold);
+    star_list_t stars2 = registration2.registerBitmap(&bitmap, luminancyThreshold);
+
+    REQUIRE(registration1.getLuminancyThreshold() == registration2.getLuminancyThreshold());
+    REQUIRE(stars1.size() == stars2.size());
+
+    for (size_t i = 0; i < stars1.size(); ++i)
+    {
+        REQUIRE(stars1[i].position.x == stars2[i].position.x);
+        REQUIRE(stars1[i].position.y == stars2[i].position.y);
+        REQUIRE(stars1[i].intensity == stars2[i].intensity);
+        REQUIRE(stars1[i].quality == stars2[i].quality);
+    }
+}
@@ -207,3 +207,151 @@ TEST_CASE("Matching synthetic stars with hot pixels", "[StarMatcher]")
         REQUIRE(angle == Approx(0.0).margin(0.001));
     }
 }
+
+
+TEST_CASE("Matching synthetic stars using a shared index", "[StarMatcher]")
+{
+    star_list_t stars1 = generateStars(100);
+    star_list_t matching_stars1 = cropStars(stars1);
+
+    stacking::utils::stars_index_ptr_t index =
+        std::make_shared<stacking::utils::StarsIndex>(matching_stars1);
+
+    REQUIRE(index->nbStars() == matching_stars1.size());
+    REQUIRE(index->points().size() == std::min(matching_stars1.size(), size_t(100)));
+    REQUIRE(index->nbTriangles() > 0);
+
+    int dxs[] = {-150, -20, 90, 210};
+    int dys[] = {-200, 10, 60, 160};
+
+    for (int i  = 0; i < 4; ++i)
+    {
+        star_list_t stars2 = translateStars(stars1, dxs[i], dys[i]);
+        star_list_t matching_stars2 = cropStars(stars2);
+
+        Transformation transformation;
+        stacking::utils::StarMatcher matcher;
+
+        REQUIRE(matcher.computeTransformation(
+            matching_stars2, matching_stars1, size2d_t(3000, 2500), transformation
+        ));
+
+        Transformation transformation2;
+        stacking::utils::StarMatcher matcher2;
+
+        REQUIRE(matcher2.computeTransformation(
+            matching_stars2, index, size2d_t(3000, 2500), transformation2
+        ));
+
+        REQUIRE(transformation2.a0 == transformation.a0);
+        REQUIRE(transformation2.a1 == transformation.a1);
+        REQUIRE(transformation2.a2 == transformation.a2);
+        REQUIRE(transformation2.a3 == transformation.a3);
+        REQUIRE(transformation2.b0 == transformation.b0);
+        REQUIRE(transformation2.b1 == transformation.b1);
+        REQUIRE(transformation2.b2 == transformation.b2);
+        REQUIRE(transformation2.b3 == transformation.b3);
+        REQUIRE(matcher2.pairs().size() == matcher.pairs().size());
+
+        double dx, dy;
+        transformation2.offsets(dx, dy);
+
+        REQUIRE(-dxs[i] == Approx(dx));
+        REQUIRE(-dys[i] == Approx(dy));
+    }
+}
+
+
+TEST_CASE("Triangles of stars", "[StarMatcher]")
+{
+    stacking::utils::triangle_t triangle(4, 7, 9, 30.0f, 50.0f, 40.0f);
+
+    REQUIRE(triangle.a == 50.0f);
+    REQUIRE(triangle.b == 40.0f);
+    REQUIRE(triangle.c == 30.0f);
+    REQUIRE(triangle.star1 == 9);
+    REQUIRE(triangle.star2 == 4);
+    REQUIRE(triangle.star3 == 7);
+}
+
+
+TEST_CASE("Matching synthetic stars using more than 100 stars", "[StarMatcher]")
+{
+    star_list_t stars1 = generateStars(300);
+    star_list_t matching_stars1 = cropStars(stars1);
+
+    stacking::utils::stars_index_ptr_t index =
+        std::make_shared<stacking::utils::StarsIndex>(matching_stars1, 200);
+
+    REQUIRE(index->points().size() == 200);
+
+    star_list_t stars2 = translateStars(stars1, 90, 60);
+    star_list_t matching_stars2 = cropStars(stars2);
+
+    Transformation transformation;
+    stacking::utils::StarMatcher matcher;
+
+    REQUIRE(matcher.computeTransformation(
+        matching_stars2, index, size2d_t(3000, 2500), transformation
+    ));
+
+    double dx, dy;
+    transformation.offsets(dx, dy);
+
+    REQUIRE(dx == Approx(-90));
+    REQUIRE(dy == Approx(-60));
+}
+
+
+TEST_CASE("Matching synthetic stars using a predicted transformation", "[StarMatcher]")
+{
+    star_list_t stars1 = generateStars(100);
+    star_list_t matching_stars1 = cropStars(stars1);
+
+    stacking::utils::stars_index_ptr_t index =
+        std::make_shared<stacking::utils::StarsIndex>(matching_stars1);
+
+    star_list_t stars2 = translateStars(stars1, 90, 60);
+    star_list_t matching_stars2 = cropStars(stars2);
+
+    Transformation expected;
+    stacking::utils::StarMatcher matcher;
+
+    REQUIRE(matcher.computeTransformation(
+        matching_stars2, index, size2d_t(3000, 2500), expected
+    ));
+
+    SECTION("Good prediction")
+    {
+        Transformation prediction = expected;
+        prediction.a0 += 3.0 / prediction.xWidth;
+        prediction.b0 -= 2.0 / prediction.yWidth;
+
+        Transformation transformation;
+        REQUIRE(matcher.computeTransformation(
+            matching_stars2, index, size2d_t(3000, 2500), transformation, 0.0, &prediction
+        ));
+
+        double dx, dy;
+        transformation.offsets(dx, dy);
+
+        REQUIRE(dx == Approx(-90));
+        REQUIRE(dy == Approx(-60));
+        REQUIRE(matcher.pairs().size() >= 8);
+    }
+
+    SECTION("Wrong prediction")
+    {
+        Transformation prediction = expected;
+        prediction.a0 += 100.0 / prediction.xWidth;
+        prediction.b0 -= 50.0 / prediction.yWidth;
+
+        Transformation transformation;
+        REQUIRE(matcher.computeTransformation(
+            matching_stars2, index, size2d_t(3000, 2500), transformation, 0.0, &prediction
+        ));
+
+        REQUIRE(transformation.a0 == expected.a0);
+        REQUIRE(transformation.b0 == expected.b0);
+    }
+}